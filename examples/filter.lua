@@ -0,0 +1,23 @@
+-- Load canvas library
+local canvas = require("canvas")
+
+-- Times function calls on canvases of common frame sizes (os.clock is processor time of all threads, so single-threaded only)
+local function benchmark(name, func)
+	for _, size in ipairs({{1920, 1080}, {3840, 2160}}) do
+		local cv = canvas.create(size[1], size[2]):clear(0, 0, 0, 0):fill("m 100 100 l 1000 100 1000 800 100 800")
+		local start = os.clock()
+		func(cv)
+		print(string.format("%s %dx%d: %.1f ms (cpu)", name, size[1], size[2], (os.clock() - start) * 1000))
+	end
+end
+benchmark("gaussian blur", function(cv) cv:blur(8, {threads = 1}) end)
+benchmark("box blur", function(cv) cv:blur(8, {mode = "box", threads = 1}) end)
+benchmark("dilate", function(cv) cv:dilate(4, {threads = 1}) end)
+benchmark("erode", function(cv) cv:erode(4, {threads = 1}) end)
+
+-- Soften bottom frame region
+function GetFrame(frame)
+	if _VIDEO then
+		canvas.blur(frame, 4, {y = _VIDEO.height - 100, height = 100, threads = 4})
+	end
+end
@@ -0,0 +1,20 @@
+local numarray = require("numarray")
+local gm = require("geometry")
+
+-- Create point array (x,y pairs) from table
+local points = numarray.create("float32", {0,0, 10,0, 10,10, 0,10})
+print("Points: " .. tostring(points) .. " with " .. #points .. " values")
+
+-- Scale & move all points at once
+points:mul(2):add(5)
+print("Transformed points: " .. table.concat(points:totable(), ", "))
+print("Bound: ", gm.bound(points))
+
+-- Reductions
+local values = numarray.create("float64", 1000):fill(0.5)
+values:copy(points, 1, #points, 1)
+print("Sum: " .. values:sum())
+print("Min & max: ", values:minmax())
+
+function GetFrame(frame)
+end
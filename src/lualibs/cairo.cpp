@@ -0,0 +1,370 @@
+/*
+Project: FLuaG
+File: cairo.cpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _WIN32	// Cairo comes with Pango on Linux only
+
+#include "libs.h"
+#include "../utils/lua.h"
+#include "../utils/image.hpp"
+#include "../utils/font.hpp"
+#include <cmath>
+#include <limits>
+
+// Unique name for Lua metatable
+#define LUA_CAIRO "cairo"
+
+// Data container for Lua userdata (image kept as uservalue)
+struct CairoData{
+	cairo_t* ctx;
+	bool staging;	// Own surface because image memory doesn't fit cairo (BGR or unaligned), drawn regions get written back
+};
+
+// Helpers
+static CairoData* luaL_checkcairo(lua_State* L, int arg, Image::View& view) noexcept{
+	CairoData* udata = *static_cast<CairoData**>(luaL_checkudata(L, arg, LUA_CAIRO));
+	// Image must still be alive (frames die after processing)
+	lua_getuservalue(L, arg);
+	lua_rawgeti(L, -1, 1);
+	if(!lua_toimage(L, -1, view))
+		luaL_error(L, "Image isn't available anymore!");
+	lua_pop(L, 2);
+	// Image memory may have been changed by others since last drawing
+	if(!udata->staging)
+		cairo_surface_mark_dirty(cairo_get_target(udata->ctx));
+	return udata;
+}
+
+static CairoData* luaL_checkcairo(lua_State* L, int arg) noexcept{
+	Image::View view;
+	return luaL_checkcairo(L, arg, view);
+}
+
+// Staging surface pixel rectangle of user extents (+1 pixel for anti-aliasing)
+struct CairoRect{int left, top, right, bottom;};
+static CairoRect cairo_ctx_rect(const CairoData* udata, const Image::View& view, double x1, double y1, double x2, double y2) noexcept{
+	double xs[4] = {x1, x2, x1, x2}, ys[4] = {y1, y1, y2, y2},
+		min_x = std::numeric_limits<double>::max(), min_y = min_x, max_x = -min_x, max_y = -min_x;
+	for(int i = 0; i < 4; ++i){
+		cairo_user_to_device(udata->ctx, xs+i, ys+i);
+		min_x = std::min(min_x, xs[i]), min_y = std::min(min_y, ys[i]), max_x = std::max(max_x, xs[i]), max_y = std::max(max_y, ys[i]);
+	}
+	return {
+		static_cast<int>(std::max(0.0, std::floor(min_x) - 1)), static_cast<int>(std::max(0.0, std::floor(min_y) - 1)),
+		static_cast<int>(std::min(static_cast<double>(view.width), std::ceil(max_x) + 1)), static_cast<int>(std::min(static_cast<double>(view.height), std::ceil(max_y) + 1))
+	};
+}
+
+// Copies image rows into staging surface (image may have been changed by others since last drawing)
+static void cairo_ctx_upload(const CairoData* udata, const Image::View& view, const CairoRect& rect) noexcept{
+	if(!udata->staging)
+		return;
+	cairo_surface_t* surf = cairo_get_target(udata->ctx);
+	cairo_surface_flush(surf);
+	unsigned char* data = cairo_image_surface_get_data(surf);
+	const int stride = cairo_image_surface_get_stride(surf);
+	const unsigned channels = view.channels();
+	for(int y = rect.top; y < rect.bottom; ++y){
+		const unsigned char* src = view.row(y) + rect.left * channels;
+		for(unsigned char* dst = data + y * stride + (rect.left << 2), *const dst_end = dst + ((rect.right - rect.left) << 2); dst < dst_end; dst += 4, src += channels)
+			dst[0] = src[0], dst[1] = src[1], dst[2] = src[2], dst[3] = 255;
+	}
+	cairo_surface_mark_dirty_rectangle(surf, rect.left, rect.top, std::max(0, rect.right - rect.left), std::max(0, rect.bottom - rect.top));
+}
+
+// Copies drawn staging surface region back to image rows (alpha stays)
+static void cairo_ctx_writeback(const CairoData* udata, const Image::View& view, const CairoRect& rect) noexcept{
+	cairo_surface_t* surf = cairo_get_target(udata->ctx);
+	cairo_surface_flush(surf);
+	if(!udata->staging)
+		return;
+	const unsigned char* data = cairo_image_surface_get_data(surf);
+	const int stride = cairo_image_surface_get_stride(surf);
+	const unsigned channels = view.channels();
+	for(int y = rect.top; y < rect.bottom; ++y){
+		const unsigned char* src = data + y * stride + (rect.left << 2);
+		for(unsigned char* dst = view.row(y) + rect.left * channels, *const dst_end = dst + (rect.right - rect.left) * channels; dst < dst_end; dst += channels, src += 4)
+			dst[0] = src[0], dst[1] = src[1], dst[2] = src[2];
+	}
+}
+
+// Draws with region bounds of current path/clip
+static int cairo_ctx_draw(lua_State* L, void(*extents)(cairo_t*, double*, double*, double*, double*), void(*draw)(cairo_t*)) noexcept{
+	Image::View view;
+	CairoData* udata = luaL_checkcairo(L, 1, view);
+	double x1, y1, x2, y2, clip_x1, clip_y1, clip_x2, clip_y2;
+	extents(udata->ctx, &x1, &y1, &x2, &y2);
+	cairo_clip_extents(udata->ctx, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+	const CairoRect rect = cairo_ctx_rect(udata, view, std::max(x1, clip_x1), std::max(y1, clip_y1), std::min(x2, clip_x2), std::min(y2, clip_y2));
+	cairo_ctx_upload(udata, view, rect);
+	draw(udata->ctx);
+	cairo_ctx_writeback(udata, view, rect);
+	lua_settop(L, 1);
+	return 1;
+}
+
+// Metatable methods
+static int cairo_ctx_free(lua_State* L) noexcept{
+	CairoData* udata = *static_cast<CairoData**>(luaL_checkudata(L, 1, LUA_CAIRO));
+	cairo_destroy(udata->ctx);
+	delete udata;
+	return 0;
+}
+
+static int cairo_ctx_moveto(lua_State* L) noexcept{
+	cairo_move_to(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_lineto(lua_State* L) noexcept{
+	cairo_line_to(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_curveto(lua_State* L) noexcept{
+	cairo_curve_to(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4), luaL_checknumber(L, 5), luaL_checknumber(L, 6), luaL_checknumber(L, 7));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_close(lua_State* L) noexcept{
+	cairo_close_path(luaL_checkcairo(L, 1)->ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_newpath(lua_State* L) noexcept{
+	cairo_new_path(luaL_checkcairo(L, 1)->ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_rectangle(lua_State* L) noexcept{
+	cairo_rectangle(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4), luaL_checknumber(L, 5));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_arc(lua_State* L) noexcept{
+	cairo_arc(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4), luaL_optnumber(L, 5, 0), luaL_optnumber(L, 6, 2 * M_PI));
+	lua_settop(L, 1);
+	return 1;
+}
+
+// Path commands appended to cairo path (curves kept for cairo's own flattening)
+class CairoPath : public Geometry::PathSink{
+	private:
+		cairo_t* const ctx;
+	public:
+		CairoPath(cairo_t* ctx) : ctx(ctx){}
+		void move(const double x, const double y) override{cairo_move_to(this->ctx, x, y);}
+		void line(const double x, const double y) override{cairo_line_to(this->ctx, x, y);}
+		void curve(const double x1, const double y1, const double x2, const double y2, const double x3, const double y3) override{cairo_curve_to(this->ctx, x1, y1, x2, y2, x3, y3);}
+		void close() override{cairo_close_path(this->ctx);}
+};
+
+static int cairo_ctx_path(lua_State* L) noexcept{
+	// Append path table (like font:textpath output) to current path
+	CairoPath path(luaL_checkcairo(L, 1)->ctx);
+	luaL_checkpath(L, 2, path, luaL_optnumber(L, 3, 0), luaL_optnumber(L, 4, 0));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_text(lua_State* L) noexcept{
+	// Get arguments
+	Image::View view;
+	CairoData* udata = luaL_checkcairo(L, 1, view);
+	const Font::Font* font = lua_tofont(L, 2);
+	luaL_argcheck(L, font, 2, "font expected");
+	size_t text_len;
+	const char* text = luaL_checklstring(L, 3, &text_len);
+	if(lua_gettop(L) > 3)
+		cairo_move_to(udata->ctx, luaL_checknumber(L, 4), luaL_checknumber(L, 5));
+	// Draw text in clip region
+	double x1, y1, x2, y2;
+	cairo_clip_extents(udata->ctx, &x1, &y1, &x2, &y2);
+	const CairoRect rect = cairo_ctx_rect(udata, view, x1, y1, x2, y2);
+	cairo_ctx_upload(udata, view, rect);
+	try{
+		font->text_draw(udata->ctx, std::string(text, text_len));
+	}catch(const Font::exception& e){
+		return luaL_error(L, e.what());
+	}
+	cairo_ctx_writeback(udata, view, rect);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_color(lua_State* L) noexcept{
+	cairo_set_source_rgba(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4), luaL_optnumber(L, 5, 1));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_linewidth(lua_State* L) noexcept{
+	cairo_set_line_width(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_fillrule(lua_State* L) noexcept{
+	static const char* rule_str[] = {"winding", "evenodd", nullptr};
+	static const cairo_fill_rule_t rule_enum[] = {CAIRO_FILL_RULE_WINDING, CAIRO_FILL_RULE_EVEN_ODD};
+	cairo_set_fill_rule(luaL_checkcairo(L, 1)->ctx, rule_enum[luaL_checkoption(L, 2, nullptr, rule_str)]);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_fill(lua_State* L) noexcept{
+	return cairo_ctx_draw(L, cairo_fill_extents, lua_toboolean(L, 2) ? cairo_fill_preserve : cairo_fill);
+}
+
+static int cairo_ctx_stroke(lua_State* L) noexcept{
+	return cairo_ctx_draw(L, cairo_stroke_extents, lua_toboolean(L, 2) ? cairo_stroke_preserve : cairo_stroke);
+}
+
+static int cairo_ctx_clip(lua_State* L) noexcept{
+	cairo_t* ctx = luaL_checkcairo(L, 1)->ctx;
+	if(lua_toboolean(L, 2))
+		cairo_clip_preserve(ctx);
+	else
+		cairo_clip(ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_resetclip(lua_State* L) noexcept{
+	cairo_reset_clip(luaL_checkcairo(L, 1)->ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_paint(lua_State* L) noexcept{
+	Image::View view;
+	CairoData* udata = luaL_checkcairo(L, 1, view);
+	const double alpha = luaL_optnumber(L, 2, 1);
+	double x1, y1, x2, y2;
+	cairo_clip_extents(udata->ctx, &x1, &y1, &x2, &y2);
+	const CairoRect rect = cairo_ctx_rect(udata, view, x1, y1, x2, y2);
+	cairo_ctx_upload(udata, view, rect);
+	cairo_paint_with_alpha(udata->ctx, alpha);
+	cairo_ctx_writeback(udata, view, rect);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_save(lua_State* L) noexcept{
+	cairo_save(luaL_checkcairo(L, 1)->ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_restore(lua_State* L) noexcept{
+	cairo_restore(luaL_checkcairo(L, 1)->ctx);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_translate(lua_State* L) noexcept{
+	cairo_translate(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_scale(lua_State* L) noexcept{
+	cairo_scale(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int cairo_ctx_rotate(lua_State* L) noexcept{
+	cairo_rotate(luaL_checkcairo(L, 1)->ctx, luaL_checknumber(L, 2));
+	lua_settop(L, 1);
+	return 1;
+}
+
+int lua_pushcairo(lua_State* L, int arg) noexcept{
+	// Get image memory
+	arg = lua_absindex(L, arg);
+	Image::View view;
+	if(!lua_toimage(L, arg, view))
+		return luaL_argerror(L, arg, "image expected");
+	if(!view.width || !view.height)
+		return luaL_error(L, "Image is empty!");
+	// Wrap BGRA rows directly (top-down for cairo, flipped by transformation), otherwise draw on copy
+	const ptrdiff_t stride = view.stride < 0 ? -view.stride : view.stride;
+	const bool staging = !view.has_alpha || stride % 4 || reinterpret_cast<uintptr_t>(view.data) % 4 || stride < cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, view.width);
+	cairo_surface_t* surf = staging ?
+		cairo_image_surface_create(CAIRO_FORMAT_RGB24, view.width, view.height) :
+		cairo_image_surface_create_for_data(view.stride < 0 ? view.row(view.height-1) : view.data, CAIRO_FORMAT_ARGB32, view.width, view.height, stride);
+	if(cairo_surface_status(surf) != CAIRO_STATUS_SUCCESS){
+		cairo_surface_destroy(surf);
+		return luaL_error(L, "Couldn't create cairo surface!");
+	}
+	cairo_t* ctx = cairo_create(surf);
+	cairo_surface_destroy(surf);	// Context holds reference
+	if(cairo_status(ctx) != CAIRO_STATUS_SUCCESS){
+		cairo_destroy(ctx);
+		return luaL_error(L, "Couldn't create cairo context!");
+	}
+	if(!staging && view.stride < 0){
+		cairo_translate(ctx, 0, view.height);
+		cairo_scale(ctx, 1, -1);
+	}
+	// Create cairo userdata
+	*static_cast<CairoData**>(lua_newuserdata(L, sizeof(CairoData*))) = new CairoData{ctx, staging};
+	if(luaL_newmetatable(L, LUA_CAIRO)){
+		static const luaL_Reg meta[] = {
+			{"__gc", cairo_ctx_free},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"moveto", cairo_ctx_moveto},
+			{"lineto", cairo_ctx_lineto},
+			{"curveto", cairo_ctx_curveto},
+			{"close", cairo_ctx_close},
+			{"newpath", cairo_ctx_newpath},
+			{"rectangle", cairo_ctx_rectangle},
+			{"arc", cairo_ctx_arc},
+			{"path", cairo_ctx_path},
+			{"text", cairo_ctx_text},
+			{"color", cairo_ctx_color},
+			{"linewidth", cairo_ctx_linewidth},
+			{"fillrule", cairo_ctx_fillrule},
+			{"fill", cairo_ctx_fill},
+			{"stroke", cairo_ctx_stroke},
+			{"clip", cairo_ctx_clip},
+			{"resetclip", cairo_ctx_resetclip},
+			{"paint", cairo_ctx_paint},
+			{"save", cairo_ctx_save},
+			{"restore", cairo_ctx_restore},
+			{"translate", cairo_ctx_translate},
+			{"scale", cairo_ctx_scale},
+			{"rotate", cairo_ctx_rotate},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	// Keep image reference for lifetime checks
+	lua_createtable(L, 1, 0);
+	lua_pushvalue(L, arg); lua_rawseti(L, -2, 1);
+	lua_setuservalue(L, -2);
+	return 1;
+}
+
+#endif
@@ -0,0 +1,604 @@
+/*
+Project: FLuaG
+File: canvas.cpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "libs.h"
+#include "../utils/lua.h"
+#include "../utils/image.hpp"
+#include "../utils/imageop.hpp"
+#include "../utils/raster.hpp"
+#include "../utils/filter.hpp"
+#include "../utils/resample.hpp"
+#include "../utils/numarray.hpp"
+
+// Unique name for Lua metatable
+#define LUA_CANVAS "canvas"
+
+using Image::Canvas;
+
+Image::Canvas* lua_tocanvas(lua_State* L, int arg) noexcept{
+	Canvas** udata = static_cast<Canvas**>(luaL_testudata(L, arg, LUA_CANVAS));
+	return udata ? *udata : nullptr;
+}
+
+bool lua_toimage(lua_State* L, int arg, Image::View& view) noexcept{
+	Canvas* canvas = lua_tocanvas(L, arg);
+	if(canvas){
+		view = canvas->view();
+		return true;
+	}
+	return lua_toframe(L, arg, view);
+}
+
+// Helpers
+static Canvas* luaL_checkcanvas(lua_State* L, int arg) noexcept{
+	return *static_cast<Canvas**>(luaL_checkudata(L, arg, LUA_CANVAS));
+}
+
+// Canvas metatable methods
+static int canvas_free(lua_State* L) noexcept{
+	delete luaL_checkcanvas(L, 1);
+	return 0;
+}
+
+static int canvas_len(lua_State* L) noexcept{
+	const Canvas* canvas = luaL_checkcanvas(L, 1);
+	lua_pushinteger(L, (static_cast<lua_Integer>(canvas->get_width()) << 2) * canvas->get_height());
+	return 1;
+}
+
+static int canvas_size(lua_State* L) noexcept{
+	const Canvas* canvas = luaL_checkcanvas(L, 1);
+	lua_pushinteger(L, canvas->get_width());
+	lua_pushinteger(L, canvas->get_height());
+	return 2;
+}
+
+static int canvas_data(lua_State* L) noexcept{
+	// Get arguments
+	Canvas* canvas = luaL_checkcanvas(L, 1);
+	size_t data_len;
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(luaL_optlstring(L, 2, nullptr, &data_len));
+	const size_t rowsize = static_cast<size_t>(canvas->get_width()) << 2,
+		image_size = rowsize * canvas->get_height();
+	// Set or get packed rows
+	if(data){
+		if(data_len != image_size)
+			return luaL_error(L, "Data size isn't equal to expected image size!");
+		ImageOp::copy(data, canvas->data(), canvas->get_height(), rowsize, canvas->get_stride());
+		lua_settop(L, 1);
+		return 1;
+	}
+	if(rowsize == canvas->get_stride())
+		lua_pushlstring(L, reinterpret_cast<const char*>(canvas->data()), image_size);
+	else{
+		luaL_Buffer buf;
+		luaL_buffinit(L, &buf);
+		for(unsigned y = 0; y < canvas->get_height(); ++y)
+			luaL_addlstring(&buf, reinterpret_cast<const char*>(canvas->data() + y * canvas->get_stride()), rowsize);
+		luaL_pushresult(&buf);
+	}
+	return 1;
+}
+
+static int canvas_clear(lua_State* L) noexcept{
+	// Get arguments (color is straight BGRA, stored premultiplied)
+	Canvas* canvas = luaL_checkcanvas(L, 1);
+	const int a = luaL_optinteger(L, 5, 0);
+	const unsigned char pixel[4] = {
+		static_cast<unsigned char>((luaL_optinteger(L, 2, 0) * a + 127) / 255),
+		static_cast<unsigned char>((luaL_optinteger(L, 3, 0) * a + 127) / 255),
+		static_cast<unsigned char>((luaL_optinteger(L, 4, 0) * a + 127) / 255),
+		static_cast<unsigned char>(a)
+	};
+	// Fill rows
+	for(unsigned y = 0; y < canvas->get_height(); ++y)
+		for(unsigned char* row = canvas->data() + y * canvas->get_stride(), *const row_end = row + (static_cast<size_t>(canvas->get_width()) << 2); row != row_end; row += 4)
+			std::copy(pixel, pixel+4, row);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int canvas_composite(lua_State* L) noexcept{
+	// Get arguments
+	Canvas* canvas = luaL_checkcanvas(L, 1);
+	Image::View dst;
+	if(!lua_toimage(L, 2, dst))
+		return luaL_argerror(L, 2, "image expected");
+	static const char* blend_str[] = {"normal", "add", "multiply", "screen", "mask", nullptr};
+	static const Image::Blend blend_enum[] = {Image::Blend::NORMAL, Image::Blend::ADD, Image::Blend::MULTIPLY, Image::Blend::SCREEN, Image::Blend::MASK};
+	const int x = luaL_optinteger(L, 3, 0), y = luaL_optinteger(L, 4, 0);
+	const double opacity = luaL_optnumber(L, 5, 1);
+	const Image::Blend mode = blend_enum[luaL_checkoption(L, 6, "normal", blend_str)];
+	// Blend onto destination
+	try{
+		Image::composite(canvas->view(), dst, x, y, opacity, mode);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 2);
+	return 1;
+}
+
+// Ignores path commands, so luaL_checkpath only validates
+class NullPath : public Geometry::PathSink{
+	public:
+		void move(const double, const double) override{}
+		void line(const double, const double) override{}
+		void curve(const double, const double, const double, const double, const double, const double) override{}
+		void close() override{}
+};
+
+// Contours by ASS drawing (string), path commands like font:textpath (table of m/l/b/c and numbers) or flattened contours (table of point tables/numeric arrays)
+static void luaL_checkcontours(lua_State* L, int arg) noexcept{
+	if(lua_type(L, arg) == LUA_TSTRING)
+		return;
+	luaL_checktype(L, arg, LUA_TTABLE);
+	lua_rawgeti(L, arg, 1);
+	const bool flat = lua_istable(L, -1) || lua_isuserdata(L, -1);
+	lua_pop(L, 1);
+	if(flat){
+		for(size_t contour_i = 1, n = lua_rawlen(L, arg); contour_i <= n; ++contour_i){
+			lua_rawgeti(L, arg, contour_i);
+			if(!lua_tonumarray(L, -1)){
+				luaL_checktype(L, -1, LUA_TTABLE);
+				for(size_t i = 1, points_n = lua_rawlen(L, -1) & ~size_t(1); i <= points_n; ++i){
+					lua_rawgeti(L, -1, i);
+					luaL_checknumber(L, -1);
+					lua_pop(L, 1);
+				}
+			}
+			lua_pop(L, 1);
+		}
+		return;
+	}
+	NullPath path;
+	luaL_checkpath(L, arg, path);
+}
+
+// Contours of argument checked by luaL_checkcontours (raises no Lua errors)
+static std::vector<Raster::Contour> lua_tocontours(lua_State* L, int arg, const double tolerance, const double dx, const double dy){
+	if(lua_type(L, arg) == LUA_TSTRING)
+		return Raster::parse_ass(lua_tostring(L, arg), tolerance, dx, dy);
+	lua_rawgeti(L, arg, 1);
+	const bool flat = lua_istable(L, -1) || lua_isuserdata(L, -1);
+	lua_pop(L, 1);
+	if(flat){
+		std::vector<Raster::Contour> contours(lua_rawlen(L, arg));
+		for(size_t contour_i = 0; contour_i < contours.size(); ++contour_i){
+			Raster::Contour& points = contours[contour_i];
+			lua_rawgeti(L, arg, 1+contour_i);
+			const NumArray::Array* arr = lua_tonumarray(L, -1);
+			if(arr){
+				points.resize(arr->size() >> 1);
+				for(size_t i = 0; i < points.size(); ++i)
+					points[i] = {arr->get(i << 1) + dx, arr->get((i << 1) + 1) + dy};
+			}else{
+				points.resize(lua_rawlen(L, -1) >> 1);
+				int i = 0;
+				for(auto& point : points){
+					lua_rawgeti(L, -1, ++i); lua_rawgeti(L, -2, ++i);
+					point = {lua_tonumber(L, -2) + dx, lua_tonumber(L, -1) + dy};
+					lua_pop(L, 2);
+				}
+			}
+			lua_pop(L, 1);
+		}
+		return contours;
+	}
+	Geometry::PathBuilder path(tolerance);
+	luaL_checkpath(L, arg, path);
+	return path.get(dx, dy);
+}
+
+// Color table entries first..first+3 (missing ones opaque/full)
+static std::array<unsigned char,4> lua_tocolor(lua_State* L, int arg, int first) noexcept{
+	std::array<unsigned char,4> color;
+	for(int c = 0; c < 4; ++c){
+		lua_rawgeti(L, arg, first + c);
+		color[c] = lua_isnil(L, -1) ? 255 : std::max(0, std::min(255, static_cast<int>(lua_tointeger(L, -1))));
+		lua_pop(L, 1);
+	}
+	return color;
+}
+
+static std::array<unsigned char,4> luaL_checkcolor(lua_State* L, int arg, int first) noexcept{
+	luaL_checktype(L, arg, LUA_TTABLE);
+	for(int c = 0; c < 4; ++c){
+		lua_rawgeti(L, arg, first + c);
+		luaL_optinteger(L, -1, 255);
+		lua_pop(L, 1);
+	}
+	return lua_tocolor(L, arg, first);
+}
+
+static int canvas_fill(lua_State* L) noexcept{
+	// Get arguments (all checked before any allocation, Lua errors would skip destructors)
+	Image::View view;
+	if(!lua_toimage(L, 1, view))
+		return luaL_argerror(L, 1, "image expected");
+	luaL_argcheck(L, lua_isnoneornil(L, 3) || lua_istable(L, 3), 3, "optional table expected");
+	static const char* rule_str[] = {"nonzero", "evenodd", nullptr};
+	static const Raster::FillRule rule_enum[] = {Raster::FillRule::NON_ZERO, Raster::FillRule::EVEN_ODD};
+	static const char* gradient_str[] = {"linear", "radial", nullptr};
+	static const Raster::Paint::Type gradient_enum[] = {Raster::Paint::Type::LINEAR, Raster::Paint::Type::RADIAL};
+	Raster::FillRule rule = Raster::FillRule::NON_ZERO;
+	double x = 0, y = 0, tolerance = 0.1;
+	int threads = 1;
+	// Gradient {type, x0, y0, x1, y1, stops = {{offset, b, g, r, a}, ...}} or solid color {b, g, r, a}
+	int gradient = 0;
+	Raster::Paint::Type type = Raster::Paint::Type::LINEAR;
+	double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	std::array<unsigned char,4> color{{255, 255, 255, 255}};
+	if(lua_istable(L, 3)){
+		lua_getfield(L, 3, "rule"); rule = rule_enum[luaL_checkoption(L, -1, "nonzero", rule_str)];
+		lua_getfield(L, 3, "x"); x = luaL_optnumber(L, -1, x);
+		lua_getfield(L, 3, "y"); y = luaL_optnumber(L, -1, y);
+		lua_getfield(L, 3, "tolerance"); tolerance = luaL_optnumber(L, -1, tolerance);
+		lua_getfield(L, 3, "threads"); threads = luaL_optinteger(L, -1, threads);
+		lua_pop(L, 5);
+		if(threads < 1)
+			return luaL_error(L, "Invalid threads number!");
+		lua_getfield(L, 3, "gradient");
+		if(!lua_isnil(L, -1)){
+			gradient = lua_gettop(L);
+			luaL_checktype(L, gradient, LUA_TTABLE);
+			lua_getfield(L, gradient, "type"); type = gradient_enum[luaL_checkoption(L, -1, "linear", gradient_str)];
+			lua_getfield(L, gradient, "x0"); x0 = luaL_checknumber(L, -1) + x;
+			lua_getfield(L, gradient, "y0"); y0 = luaL_checknumber(L, -1) + y;
+			lua_getfield(L, gradient, "x1"); x1 = luaL_checknumber(L, -1) + x;
+			lua_getfield(L, gradient, "y1"); y1 = luaL_checknumber(L, -1) + y;
+			lua_pop(L, 5);
+			lua_getfield(L, gradient, "stops");
+			luaL_checktype(L, -1, LUA_TTABLE);
+			for(size_t i = 1, n = lua_rawlen(L, -1); i <= n; ++i){
+				lua_rawgeti(L, -1, i);
+				luaL_checktype(L, -1, LUA_TTABLE);
+				lua_rawgeti(L, -1, 1);
+				luaL_checknumber(L, -1);
+				luaL_checkcolor(L, -2, 2);
+				lua_pop(L, 2);
+			}
+			lua_pop(L, 1);	// Keep gradient table on stack for reading stops after checks
+		}else{
+			lua_pop(L, 1);
+			lua_getfield(L, 3, "color");
+			if(!lua_isnil(L, -1))
+				color = luaL_checkcolor(L, -1, 1);
+			lua_pop(L, 1);
+		}
+	}
+	luaL_checkcontours(L, 2);
+	// Rasterize into image
+	try{
+		std::unique_ptr<Raster::Paint> paint;
+		if(gradient){
+			lua_getfield(L, gradient, "stops");
+			std::vector<Raster::Paint::Stop> stops(lua_rawlen(L, -1));
+			for(size_t i = 0; i < stops.size(); ++i){
+				lua_rawgeti(L, -1, i+1);
+				lua_rawgeti(L, -1, 1);
+				stops[i] = {lua_tonumber(L, -1), lua_tocolor(L, -2, 2)};
+				lua_pop(L, 2);
+			}
+			lua_pop(L, 1);
+			paint.reset(new Raster::Paint(type, x0, y0, x1, y1, stops));
+		}else
+			paint.reset(new Raster::Paint(color));
+		Raster::fill(lua_tocontours(L, 2, tolerance, x, y), rule, *paint, view, threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+// Filter arguments: image, radius[, options{radius_y, x, y, width, height, threads}] (region relative to image)
+static Image::View luaL_checkfilter(lua_State* L, double& radius_x, double& radius_y, int& threads) noexcept{
+	Image::View view;
+	if(!lua_toimage(L, 1, view))
+		luaL_argerror(L, 1, "image expected");
+	radius_x = radius_y = luaL_checknumber(L, 2);
+	luaL_argcheck(L, lua_isnoneornil(L, 3) || lua_istable(L, 3), 3, "optional table expected");
+	threads = 1;
+	if(lua_istable(L, 3)){
+		lua_getfield(L, 3, "radius_y"); radius_y = luaL_optnumber(L, -1, radius_y);
+		lua_getfield(L, 3, "x"); const int x = luaL_optinteger(L, -1, 0);
+		lua_getfield(L, 3, "y"); const int y = luaL_optinteger(L, -1, 0);
+		lua_getfield(L, 3, "width"); const int width = luaL_optinteger(L, -1, view.width);
+		lua_getfield(L, 3, "height"); const int height = luaL_optinteger(L, -1, view.height);
+		lua_getfield(L, 3, "threads"); threads = luaL_optinteger(L, -1, threads);
+		lua_pop(L, 6);
+		view = view.sub(x, y, width, height);
+	}
+	if(radius_x < 0 || radius_y < 0)
+		luaL_error(L, "Invalid radius!");
+	if(threads < 1)
+		luaL_error(L, "Invalid threads number!");
+	return view;
+}
+
+static int canvas_blur(lua_State* L) noexcept{
+	// Get arguments
+	double radius_x, radius_y;
+	int threads;
+	const Image::View view = luaL_checkfilter(L, radius_x, radius_y, threads);
+	static const char* mode_str[] = {"gaussian", "box", nullptr};
+	int mode = 0;
+	if(lua_istable(L, 3)){
+		lua_getfield(L, 3, "mode"); mode = luaL_checkoption(L, -1, "gaussian", mode_str);
+		lua_pop(L, 1);
+	}
+	// Blur region (gaussian by standard deviation, box by pixel radius)
+	try{
+		if(mode == 0)
+			Filter::gaussian_blur(view, radius_x, radius_y, threads);
+		else
+			Filter::box_blur(view, std::lround(radius_x), std::lround(radius_y), threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int canvas_dilate(lua_State* L) noexcept{
+	double radius_x, radius_y;
+	int threads;
+	const Image::View view = luaL_checkfilter(L, radius_x, radius_y, threads);
+	try{
+		Filter::dilate(view, std::lround(radius_x), std::lround(radius_y), threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int canvas_erode(lua_State* L) noexcept{
+	double radius_x, radius_y;
+	int threads;
+	const Image::View view = luaL_checkfilter(L, radius_x, radius_y, threads);
+	try{
+		Filter::erode(view, std::lround(radius_x), std::lround(radius_y), threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+// Resampling source: image or mipmap levels (table of images like mipmaps returns)
+static std::vector<Image::View> luaL_checklevels(lua_State* L, int arg) noexcept{
+	std::vector<Image::View> levels(1);
+	if(lua_istable(L, arg)){
+		levels.resize(lua_rawlen(L, arg));
+		luaL_argcheck(L, !levels.empty(), arg, "mipmaps expected");
+		for(size_t i = 0; i < levels.size(); ++i){
+			lua_rawgeti(L, arg, 1+i);
+			if(!lua_toimage(L, -1, levels[i]))
+				luaL_argerror(L, arg, "mipmaps expected");
+			lua_pop(L, 1);
+		}
+	}else if(!lua_toimage(L, arg, levels.front()))
+		luaL_argerror(L, arg, "image or mipmaps expected");
+	return levels;
+}
+
+// Resamples source region (options x, y, width, height) from best-fitting level into destination (clipped part at offset of full size)
+static int luaL_resample(lua_State* L, const std::vector<Image::View>& levels, const Image::View& dst, int options,
+		int full_width = 0, int full_height = 0, int offset_x = 0, int offset_y = 0) noexcept{
+	static const char* filter_str[] = {"bilinear", "bicubic", "lanczos", nullptr};
+	static const Resample::Kernel filter_enum[] = {Resample::Kernel::BILINEAR, Resample::Kernel::BICUBIC, Resample::Kernel::LANCZOS};
+	Resample::Kernel kernel = Resample::Kernel::BICUBIC;
+	double x = 0, y = 0, width = levels.front().width, height = levels.front().height;
+	int threads = 1;
+	if(lua_istable(L, options)){
+		lua_getfield(L, options, "filter"); kernel = filter_enum[luaL_checkoption(L, -1, "bicubic", filter_str)];
+		lua_getfield(L, options, "x"); x = luaL_optnumber(L, -1, x);
+		lua_getfield(L, options, "y"); y = luaL_optnumber(L, -1, y);
+		lua_getfield(L, options, "width"); width = luaL_optnumber(L, -1, width);
+		lua_getfield(L, options, "height"); height = luaL_optnumber(L, -1, height);
+		lua_getfield(L, options, "threads"); threads = luaL_optinteger(L, -1, threads);
+		lua_pop(L, 6);
+	}
+	if(!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(width) || !std::isfinite(height) || width <= 0 || height <= 0)
+		return luaL_error(L, "Invalid source region!");
+	if(threads < 1)
+		return luaL_error(L, "Invalid threads number!");
+	if(full_width > 0 && full_height > 0){
+		const double scale_x = width / full_width, scale_y = height / full_height;
+		x += offset_x * scale_x, y += offset_y * scale_y;
+		width = dst.width * scale_x, height = dst.height * scale_y;
+	}
+	// Smallest level still covering destination resolution
+	const Image::View& level = levels[Resample::select_level(levels, width, height, dst.width, dst.height)];
+	const double scale_x = static_cast<double>(level.width) / levels.front().width, scale_y = static_cast<double>(level.height) / levels.front().height;
+	try{
+		Resample::resize(level, dst, x * scale_x, y * scale_y, width * scale_x, height * scale_y, kernel, threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 0;
+}
+
+static int canvas_resize(lua_State* L) noexcept{
+	// Get arguments
+	const std::vector<Image::View> levels = luaL_checklevels(L, 1);
+	Image::View dst;
+	if(!lua_toimage(L, 2, dst))
+		return luaL_argerror(L, 2, "image expected");
+	luaL_argcheck(L, lua_isnoneornil(L, 3) || lua_istable(L, 3), 3, "optional table expected");
+	int x = 0, y = 0, width = dst.width, height = dst.height;
+	if(lua_istable(L, 3)){
+		lua_getfield(L, 3, "dst_x"); x = luaL_optinteger(L, -1, x);
+		lua_getfield(L, 3, "dst_y"); y = luaL_optinteger(L, -1, y);
+		lua_getfield(L, 3, "dst_width"); width = luaL_optinteger(L, -1, width);
+		lua_getfield(L, 3, "dst_height"); height = luaL_optinteger(L, -1, height);
+		lua_pop(L, 4);
+	}
+	// Scale into destination region (clipped part keeps source mapping)
+	const Image::View region = dst.sub(x, y, width, height);
+	if(region.width && region.height)
+		luaL_resample(L, levels, region, 3, width, height, std::max(0, -x), std::max(0, -y));
+	lua_settop(L, 2);
+	return 1;
+}
+
+static int canvas_scale(lua_State* L) noexcept{
+	// Get arguments
+	const std::vector<Image::View> levels = luaL_checklevels(L, 1);
+	const lua_Integer width = luaL_checkinteger(L, 2),
+		height = luaL_checkinteger(L, 3);
+	if(width <= 0 || height <= 0 || !Canvas::valid_size(width, height))
+		return luaL_error(L, "Invalid dimensions!");
+	luaL_argcheck(L, lua_isnoneornil(L, 4) || lua_istable(L, 4), 4, "optional table expected");
+	// Scale into new canvas
+	Canvas* canvas;
+	try{
+		canvas = new Canvas(width, height);
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}
+	lua_pushcanvas(L, canvas);
+	luaL_resample(L, levels, canvas->view(), 4);
+	return 1;
+}
+
+static int canvas_mipmaps(lua_State* L) noexcept{
+	// Get arguments
+	Image::View view;
+	if(!lua_toimage(L, 1, view))
+		return luaL_argerror(L, 1, "image expected");
+	luaL_argcheck(L, lua_isnoneornil(L, 2) || lua_istable(L, 2), 2, "optional table expected");
+	int levels = -1, threads = 1;
+	if(lua_istable(L, 2)){
+		lua_getfield(L, 2, "levels"); levels = luaL_optinteger(L, -1, levels);
+		lua_getfield(L, 2, "threads"); threads = luaL_optinteger(L, -1, threads);
+		lua_pop(L, 2);
+	}
+	if(threads < 1)
+		return luaL_error(L, "Invalid threads number!");
+	// Image followed by halving levels
+	std::vector<std::unique_ptr<Canvas>> mipmaps;
+	try{
+		mipmaps = Resample::mipmaps(view, levels < 0 ? ~0u : levels, threads);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_createtable(L, 1 + mipmaps.size(), 0);
+	lua_pushvalue(L, 1); lua_rawseti(L, -2, 1);
+	for(size_t i = 0; i < mipmaps.size(); ++i){
+		lua_pushcanvas(L, mipmaps[i].release());
+		lua_rawseti(L, -2, 2+i);
+	}
+	return 1;
+}
+
+#ifndef _WIN32
+static int canvas_cairo(lua_State* L) noexcept{
+	luaL_checkcanvas(L, 1);
+	return lua_pushcairo(L, 1);
+}
+#endif
+
+void lua_pushcanvas(lua_State* L, Canvas* canvas) noexcept{
+	*static_cast<Canvas**>(lua_newuserdata(L, sizeof(Canvas*))) = canvas;
+	if(luaL_newmetatable(L, LUA_CANVAS)){
+		static const luaL_Reg meta[] = {
+			{"__gc", canvas_free},
+			{"__len", canvas_len},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"size", canvas_size},
+			{"data", canvas_data},
+			{"clear", canvas_clear},
+			{"fill", canvas_fill},
+			{"composite", canvas_composite},
+			{"blur", canvas_blur},
+			{"dilate", canvas_dilate},
+			{"erode", canvas_erode},
+			{"resize", canvas_resize},
+			{"scale", canvas_scale},
+			{"mipmaps", canvas_mipmaps},
+#ifndef _WIN32
+			{"cairo", canvas_cairo},
+#endif
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+}
+
+// General functions
+static int canvas_create(lua_State* L) noexcept{
+	// Get arguments
+	const lua_Integer width = luaL_checkinteger(L, 1),
+		height = luaL_checkinteger(L, 2);
+	if(width <= 0 || height <= 0 || !Canvas::valid_size(width, height))
+		return luaL_error(L, "Invalid dimensions!");
+	// Create canvas userdata
+	Canvas* canvas;
+	try{
+		canvas = new Canvas(width, height);
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}
+	lua_pushcanvas(L, canvas);
+	return 1;
+}
+
+static int canvas_pool(lua_State* L) noexcept{
+	// Set memory budget
+	if(!lua_isnoneornil(L, 1)){
+		const lua_Integer budget = luaL_checkinteger(L, 1);
+		luaL_argcheck(L, budget >= 0, 1, "negative budget");
+		Image::pool().set_budget(budget);
+	}
+	// Get statistics
+	const Image::Pool::Stats stats = Image::pool().get_stats();
+	lua_createtable(L, 0, 6);
+	lua_pushinteger(L, stats.hits); lua_setfield(L, -2, "hits");
+	lua_pushinteger(L, stats.misses); lua_setfield(L, -2, "misses");
+	lua_pushnumber(L, stats.hits + stats.misses ? static_cast<double>(stats.hits) / (stats.hits + stats.misses) : 0); lua_setfield(L, -2, "hit_rate");
+	lua_pushinteger(L, stats.entries); lua_setfield(L, -2, "entries");
+	lua_pushinteger(L, stats.bytes); lua_setfield(L, -2, "bytes");
+	lua_pushinteger(L, stats.budget); lua_setfield(L, -2, "budget");
+	return 1;
+}
+
+static int canvas_clear_pool(lua_State*) noexcept{
+	Image::pool().clear();
+	return 0;
+}
+
+int luaopen_canvas(lua_State* L)/* No exception specifier because of C declaration */{
+	static const luaL_Reg l[] = {
+		{"create", canvas_create},
+		{"fill", canvas_fill},
+		{"blur", canvas_blur},
+		{"dilate", canvas_dilate},
+		{"erode", canvas_erode},
+		{"resize", canvas_resize},
+		{"scale", canvas_scale},
+		{"mipmaps", canvas_mipmaps},
+		{"pool", canvas_pool},
+		{"clearpool", canvas_clear_pool},
+		{NULL, NULL}
+	};
+	luaL_newlib(L, l);
+	return 1;
+}
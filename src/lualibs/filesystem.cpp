@@ -15,9 +15,164 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "libs.h"
 #include "../utils/lua.h"
 #include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "../utils/filewatch.hpp"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#ifndef _WIN32
+	#include <sys/stat.h>
+#endif
 
 using namespace boost;
 
+// Unique names for Lua metatables
+#define LUA_FILESYSTEM_WALKER "filesystem_walker"
+#define LUA_FILESYSTEM_MMAP "filesystem_mmap"
+#define LUA_FILESYSTEM_WATCHER "filesystem_watcher"
+
+// Names of file types (by filesystem::file_type, looked up instead of switched on as boost versions add internal values)
+static const char* filetype_str(const filesystem::file_type ft) noexcept{
+	static const struct{filesystem::file_type type; const char* name;} names[] = {
+		{filesystem::status_error, "status_error"},
+		{filesystem::file_not_found, "file_not_found"},
+		{filesystem::regular_file, "regular_file"},
+		{filesystem::directory_file, "directory_file"},
+		{filesystem::symlink_file, "symlink_file"},
+		{filesystem::block_file, "block_file"},
+		{filesystem::character_file, "character_file"},
+		{filesystem::fifo_file, "fifo_file"},
+		{filesystem::socket_file, "socket_file"}
+	};
+	for(const auto& entry : names)
+		if(entry.type == ft)
+			return entry.name;
+	return "type_unknown";
+}
+
+// File type, size & last modification time (without following symlinks)
+struct FileInfo{
+	filesystem::file_type type;
+	uintmax_t size;
+	std::time_t mtime;
+};
+static FileInfo fileinfo(const filesystem::path& path) noexcept{
+#ifdef _WIN32
+	system::error_code ec;
+	const filesystem::file_status status = filesystem::symlink_status(path, ec);
+	FileInfo info{filesystem::is_symlink(status) ? filesystem::symlink_file : status.type(), 0, 0};
+	if(info.type == filesystem::regular_file)
+		info.size = filesystem::file_size(path, ec);
+	info.mtime = filesystem::last_write_time(path, ec);
+	return info;
+#else
+	struct stat st;
+	if(lstat(path.c_str(), &st) != 0)
+		return {filesystem::status_error, 0, 0};
+	return {
+		S_ISREG(st.st_mode) ? filesystem::regular_file :
+		S_ISDIR(st.st_mode) ? filesystem::directory_file :
+		S_ISLNK(st.st_mode) ? filesystem::symlink_file :
+		S_ISBLK(st.st_mode) ? filesystem::block_file :
+		S_ISCHR(st.st_mode) ? filesystem::character_file :
+		S_ISFIFO(st.st_mode) ? filesystem::fifo_file :
+		S_ISSOCK(st.st_mode) ? filesystem::socket_file : filesystem::type_unknown,
+		static_cast<uintmax_t>(st.st_size),
+		st.st_mtime
+	};
+#endif
+}
+
+// Glob pattern (*, ?, [...]) to regular expression
+static std::string glob_to_regex(const std::string& glob){
+	std::string expr;
+	expr.reserve(glob.size() << 1);
+	bool in_set = false;
+	for(const char c : glob)
+		if(in_set){
+			if(c == ']')
+				in_set = false;
+			else if(c == '\\')
+				expr += '\\';
+			expr += c;
+		}else
+			switch(c){
+				case '*': expr += ".*"; break;
+				case '?': expr += '.'; break;
+				case '[': expr += '['; in_set = true; break;
+				case '.': case '+': case '(': case ')': case '{': case '}': case '^': case '$': case '|': case '\\': case ']':
+					expr += '\\';
+					expr += c;
+					break;
+				default: expr += c; break;
+			}
+	return expr;
+}
+
+// Directory tree iteration state
+struct Walker{
+	// Options
+	const bool recursive, sort, dirs;
+	const int max_depth;
+	const std::unique_ptr<const boost::regex> filter;
+	// Open directory levels (sorted: entries buffer, unsorted: iterator)
+	struct Level{
+		filesystem::directory_iterator it;
+		std::vector<filesystem::path> entries;
+		size_t entries_i;
+	};
+	std::vector<Level> levels;
+	void open(const filesystem::path& dir){
+		system::error_code ec;
+		filesystem::directory_iterator it(dir, ec);
+		if(ec)
+			return;	// Skip unreadable directories
+		if(this->sort){
+			std::vector<filesystem::path> entries;
+			for(filesystem::directory_iterator it_end; it != it_end && !ec; it.increment(ec))	// Stop at failed increment (iterator may not advance)
+				entries.push_back(it->path());
+			std::sort(entries.begin(), entries.end());
+			this->levels.push_back({filesystem::directory_iterator(), std::move(entries), 0});
+		}else
+			this->levels.push_back({it, std::vector<filesystem::path>(), 0});
+	}
+	bool next(filesystem::path& path, FileInfo& info){
+		while(!this->levels.empty()){
+			// Fetch next entry of current level
+			Level& level = this->levels.back();
+			if(this->sort){
+				if(level.entries_i == level.entries.size()){
+					this->levels.pop_back();
+					continue;
+				}
+				path = std::move(level.entries[level.entries_i++]);
+			}else{
+				if(level.it == filesystem::directory_iterator()){
+					this->levels.pop_back();
+					continue;
+				}
+				path = level.it->path();
+				system::error_code ec;
+				level.it.increment(ec);
+				if(ec)
+					level.it = filesystem::directory_iterator();
+			}
+			info = fileinfo(path);
+			// Descend (pre-order)
+			if(info.type == filesystem::directory_file && this->recursive && (this->max_depth < 0 || static_cast<int>(this->levels.size()) <= this->max_depth))
+				this->open(path);
+			// Filter
+			if((info.type != filesystem::directory_file || this->dirs) &&
+				(!this->filter || boost::regex_match(path.filename().string(), *this->filter)))
+				return true;
+		}
+		return false;
+	}
+};
+
 static int filesystem_absolute(lua_State* L) noexcept{
 	lua_pushstring(L, filesystem::absolute(luaL_checkstring(L, 1)).string().c_str());
 	return 1;
@@ -252,6 +407,257 @@ static int filesystem_dir(lua_State* L) noexcept{
 	return 0;
 }
 
+static int filesystem_walker_free(lua_State* L) noexcept{
+	delete *static_cast<Walker**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_WALKER));
+	return 0;
+}
+
+static int filesystem_walker_next(lua_State* L) noexcept{
+	Walker* walker = *static_cast<Walker**>(lua_touserdata(L, lua_upvalueindex(1)));
+	filesystem::path path;
+	FileInfo info;
+	try{
+		if(!walker->next(path, info))
+			return 0;
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_pushstring(L, path.string().c_str());
+	lua_pushstring(L, filetype_str(info.type));
+	lua_pushinteger(L, info.size);
+	lua_pushinteger(L, info.mtime);
+	return 4;
+}
+
+static int filesystem_walk(lua_State* L) noexcept{
+	// Get arguments
+	const char* dir = luaL_checkstring(L, 1);
+	luaL_argcheck(L, lua_isnoneornil(L, 2) || lua_istable(L, 2), 2, "optional table expected");
+	lua_settop(L, 2);
+	bool recursive = true, sort = false, dirs = true;
+	int max_depth = -1;
+	std::string filter;
+	if(lua_istable(L, 2)){
+		lua_getfield(L, 2, "recursive"); recursive = luaL_optboolean(L, -1, recursive);
+		lua_getfield(L, 2, "sort"); sort = luaL_optboolean(L, -1, sort);
+		lua_getfield(L, 2, "dirs"); dirs = luaL_optboolean(L, -1, dirs);
+		lua_getfield(L, 2, "depth"); max_depth = luaL_optinteger(L, -1, max_depth);
+		lua_getfield(L, 2, "glob");
+		lua_getfield(L, 2, "regex");
+		if(lua_isstring(L, -1))
+			filter = lua_tostring(L, -1);
+		else if(lua_isstring(L, -2))
+			filter = glob_to_regex(lua_tostring(L, -2));
+		lua_pop(L, 6);
+	}
+	// Create walker userdata
+	try{
+		Walker* walker = new Walker{recursive, sort, dirs, max_depth, std::unique_ptr<const boost::regex>(filter.empty() ? nullptr : new boost::regex(filter)), {}};
+		*static_cast<Walker**>(lua_newuserdata(L, sizeof(Walker*))) = walker;
+		walker->open(dir);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(luaL_newmetatable(L, LUA_FILESYSTEM_WALKER)){
+		lua_pushcfunction(L, filesystem_walker_free); lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+	// Return iterator
+	lua_pushcclosure(L, filesystem_walker_next, 1);
+	return 1;
+}
+
+// Read-only file mapping (empty files have no region)
+struct MappedFile{
+	interprocess::file_mapping mapping;
+	interprocess::mapped_region region;
+	const char* data() const noexcept{return static_cast<const char*>(this->region.get_address());}
+	size_t size() const noexcept{return this->region.get_size();}
+};
+
+const char* lua_tobytes(lua_State* L, int arg, size_t* len) noexcept{
+	if(lua_type(L, arg) == LUA_TSTRING)
+		return lua_tolstring(L, arg, len);
+	MappedFile** udata = static_cast<MappedFile**>(luaL_testudata(L, arg, LUA_FILESYSTEM_MMAP));
+	if(udata){
+		*len = (*udata)->size();
+		return *len ? (*udata)->data() : "";
+	}
+	return nullptr;
+}
+
+// Converts (negative) 1-based byte range into 0-based offset & length (false if empty)
+static bool mmap_range(const MappedFile* mf, lua_Integer i, lua_Integer j, size_t& offset, size_t& len) noexcept{
+	const lua_Integer n = mf->size();
+	if(i < 0)
+		i = i + n + 1 < 1 ? 1 : i + n + 1;
+	else if(i == 0)
+		i = 1;
+	if(j < 0)
+		j += n + 1;
+	else if(j > n)
+		j = n;
+	if(i > j)
+		return false;
+	offset = i - 1, len = j - i + 1;
+	return true;
+}
+
+static int filesystem_mmap_free(lua_State* L) noexcept{
+	delete *static_cast<MappedFile**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_MMAP));
+	return 0;
+}
+
+static int filesystem_mmap_len(lua_State* L) noexcept{
+	lua_pushinteger(L, (*static_cast<MappedFile**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_MMAP)))->size());
+	return 1;
+}
+
+static int filesystem_mmap_sub(lua_State* L) noexcept{
+	const MappedFile* mf = *static_cast<MappedFile**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_MMAP));
+	size_t offset, len;
+	if(mmap_range(mf, luaL_optinteger(L, 2, 1), luaL_optinteger(L, 3, -1), offset, len))
+		lua_pushlstring(L, mf->data() + offset, len);
+	else
+		lua_pushliteral(L, "");
+	return 1;
+}
+
+static int filesystem_mmap_byte(lua_State* L) noexcept{
+	const MappedFile* mf = *static_cast<MappedFile**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_MMAP));
+	const lua_Integer i = luaL_optinteger(L, 2, 1);
+	size_t offset, len;
+	if(!mmap_range(mf, i, luaL_optinteger(L, 3, i), offset, len))
+		return 0;
+	if(!lua_checkstack(L, len))
+		return luaL_error(L, "Too many bytes requested!");
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(mf->data()) + offset;
+	for(const unsigned char* data_end = data + len; data != data_end; ++data)
+		lua_pushinteger(L, *data);
+	return len;
+}
+
+static int filesystem_mmap_number(lua_State* L) noexcept{
+	const MappedFile* mf = *static_cast<MappedFile**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_MMAP));
+	static const char* option_str[] = {"int8", "uint8", "int16", "uint16", "int32", "uint32", "float", "double", nullptr};
+	static const unsigned option_size[] = {1, 1, 2, 2, 4, 4, 4, 8};
+	const int type = luaL_checkoption(L, 2, nullptr, option_str);
+	const lua_Integer pos = luaL_optinteger(L, 3, 1);
+	// Read number in native byte order (unaligned)
+	if(pos < 1 || static_cast<size_t>(pos-1) + option_size[type] > mf->size())
+		return 0;
+	const char* data = mf->data() + (pos-1);
+	union{int8_t i8; uint8_t u8; int16_t i16; uint16_t u16; int32_t i32; uint32_t u32; float f; double d;} value;
+	std::memcpy(&value, data, option_size[type]);
+	switch(type){
+		case 0: lua_pushinteger(L, value.i8); break;
+		case 1: lua_pushinteger(L, value.u8); break;
+		case 2: lua_pushinteger(L, value.i16); break;
+		case 3: lua_pushinteger(L, value.u16); break;
+		case 4: lua_pushinteger(L, value.i32); break;
+		case 5: lua_pushnumber(L, value.u32); break;
+		case 6: lua_pushnumber(L, value.f); break;
+		case 7: lua_pushnumber(L, value.d); break;
+	}
+	return 1;
+}
+
+static int filesystem_mmap(lua_State* L) noexcept{
+	const char* path = luaL_checkstring(L, 1);
+	// Map whole file
+	MappedFile* mf;
+	try{
+		interprocess::file_mapping mapping(path, interprocess::read_only);
+		interprocess::mapped_region region;
+		if(filesystem::file_size(path) > 0)
+			interprocess::mapped_region(mapping, interprocess::read_only).swap(region);
+		mf = new MappedFile{std::move(mapping), std::move(region)};
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	// Create mapping userdata
+	*static_cast<MappedFile**>(lua_newuserdata(L, sizeof(MappedFile*))) = mf;
+	if(luaL_newmetatable(L, LUA_FILESYSTEM_MMAP)){
+		static const luaL_Reg meta[] = {
+			{"__gc", filesystem_mmap_free},
+			{"__len", filesystem_mmap_len},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"sub", filesystem_mmap_sub},
+			{"byte", filesystem_mmap_byte},
+			{"number", filesystem_mmap_number},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int filesystem_watcher_free(lua_State* L) noexcept{
+	delete *static_cast<FileWatch::Watcher**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_WATCHER));
+	return 0;
+}
+
+static int filesystem_watcher_changed(lua_State* L) noexcept{
+	FileWatch::Watcher* watcher = *static_cast<FileWatch::Watcher**>(luaL_checkudata(L, 1, LUA_FILESYSTEM_WATCHER));
+	if(!watcher->changed()){
+		lua_pushboolean(L, false);
+		return 1;
+	}
+	lua_pushboolean(L, true);
+	try{
+		const std::vector<std::string> changes = watcher->fetch();
+		lua_createtable(L, changes.size(), 0);
+		for(size_t i = 0; i < changes.size(); ++i){
+			lua_pushstring(L, changes[i].c_str()); lua_rawseti(L, -2, i+1);
+		}
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 2;
+}
+
+static int filesystem_watch(lua_State* L) noexcept{
+	// Get arguments
+	std::vector<std::string> paths;
+	if(lua_istable(L, 1)){
+		const size_t n = lua_rawlen(L, 1);
+		for(size_t i = 1; i <= n; ++i){
+			lua_rawgeti(L, 1, i);
+			if(!lua_isstring(L, -1))
+				return luaL_error(L, "Table must contain paths only!");
+			paths.push_back(lua_tostring(L, -1));
+			lua_pop(L, 1);
+		}
+	}else
+		paths.push_back(luaL_checkstring(L, 1));
+	const int interval = luaL_optinteger(L, 2, 500);
+	luaL_argcheck(L, interval > 0, 2, "positive interval expected");
+	// Create watcher userdata
+	try{
+		*static_cast<FileWatch::Watcher**>(lua_newuserdata(L, sizeof(FileWatch::Watcher*))) = new FileWatch::Watcher(paths, std::chrono::milliseconds(interval));
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(luaL_newmetatable(L, LUA_FILESYSTEM_WATCHER)){
+		static const luaL_Reg meta[] = {
+			{"__gc", filesystem_watcher_free},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"changed", filesystem_watcher_changed},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
 int luaopen_filesystem(lua_State* L)/* No exception specifier because of C declaration */{
 	static const luaL_Reg l[] = {
 		{"absolute", filesystem_absolute},
@@ -274,6 +680,9 @@ int luaopen_filesystem(lua_State* L)/* No exception specifier because of C decla
 		{"tmpdir", filesystem_tmpdir},
 		{"unique", filesystem_unique},
 		{"dir", filesystem_dir},
+		{"walk", filesystem_walk},
+		{"mmap", filesystem_mmap},
+		{"watch", filesystem_watch},
 		{NULL, NULL}
 	};
 	luaL_newlib(L, l);
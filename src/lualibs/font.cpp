@@ -15,36 +15,62 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "libs.h"
 #include "../utils/lua.h"
 #include "../utils/font.hpp"
+#include "../utils/sdf.hpp"
+#include "../utils/numarray.hpp"
+#include <cmath>
+#include <climits>
 
 #define LUA_FONT "font"
 
+// Helpers (userdata holds share of pooled font)
+static Font::Font* luaL_checkfont(lua_State* L, int arg) noexcept{
+	return (*static_cast<std::shared_ptr<Font::Font>**>(luaL_checkudata(L, arg, LUA_FONT)))->get();
+}
+
+Font::Font* lua_tofont(lua_State* L, int arg) noexcept{
+	std::shared_ptr<Font::Font>** udata = static_cast<std::shared_ptr<Font::Font>**>(luaL_testudata(L, arg, LUA_FONT));
+	return udata ? (*udata)->get() : nullptr;
+}
+
+static void lua_pushfontentries(lua_State* L, const std::vector<Font::ListEntry>& list) noexcept{
+	lua_createtable(L, list.size(), 0);
+	int i = 0;
+	for(const auto& entry : list){
+		lua_createtable(L, 0, 5);
+		lua_pushstring(L, entry.family.c_str()); lua_setfield(L, -2, "family");
+		lua_pushstring(L, entry.style.c_str()); lua_setfield(L, -2, "style");
+		lua_pushstring(L, entry.file.c_str()); lua_setfield(L, -2, "file");
+		lua_pushstring(L, entry.script.c_str()); lua_setfield(L, -2, "script");
+		lua_pushboolean(L, entry.outline); lua_setfield(L, -2, "outline");
+		lua_rawseti(L, -2, ++i);
+	}
+}
+
 static int font_list(lua_State* L) noexcept{
 	try{
-		const auto list = Font::list();
-		lua_createtable(L, list.size(), 0);
-		int i = 0;
-		for(const auto& entry : list){
-			lua_createtable(L, 0, 5);
-			lua_pushstring(L, entry.family.c_str()); lua_setfield(L, -2, "family");
-			lua_pushstring(L, entry.style.c_str()); lua_setfield(L, -2, "style");
-			lua_pushstring(L, entry.file.c_str()); lua_setfield(L, -2, "file");
-			lua_pushstring(L, entry.script.c_str()); lua_setfield(L, -2, "script");
-			lua_pushboolean(L, entry.outline); lua_setfield(L, -2, "outline");
-			lua_rawseti(L, -2, ++i);
-		}
-	}catch(const Font::exception& e){
+		lua_pushfontentries(L, *Font::index().all());
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int font_find(lua_State* L) noexcept{
+	try{
+		lua_pushfontentries(L, Font::index().find(luaL_checkstring(L, 1), luaL_optstring(L, 2, ""), luaL_optstring(L, 3, "")));
+	}catch(const std::exception& e){
 		return luaL_error(L, e.what());
 	}
 	return 1;
 }
 
 static int font_free(lua_State* L) noexcept{
-	delete *static_cast<Font::Font**>(luaL_checkudata(L, 1, LUA_FONT));
+	delete *static_cast<std::shared_ptr<Font::Font>**>(luaL_checkudata(L, 1, LUA_FONT));
 	return 0;
 }
 
 static int font_data(lua_State* L) noexcept{
-	const Font::Font* font = *static_cast<Font::Font**>(luaL_checkudata(L, 1, LUA_FONT));
+	const Font::Font* font = luaL_checkfont(L, 1);
 	lua_pushstring(L, font->get_family().c_str());
 	lua_pushnumber(L, font->get_size());
 	lua_pushboolean(L, font->get_bold());
@@ -57,7 +83,7 @@ static int font_data(lua_State* L) noexcept{
 }
 
 static int font_metrics(lua_State* L) noexcept{
-	const Font::Font::Metrics metrics = (*static_cast<Font::Font**>(luaL_checkudata(L, 1, LUA_FONT)))->metrics();
+	const Font::Font::Metrics metrics = luaL_checkfont(L, 1)->metrics();
 	lua_pushnumber(L, metrics.height);
 	lua_pushnumber(L, metrics.ascent);
 	lua_pushnumber(L, metrics.descent);
@@ -67,58 +93,351 @@ static int font_metrics(lua_State* L) noexcept{
 }
 
 static int font_text_width(lua_State* L) noexcept{
-	lua_pushnumber(L, (*static_cast<Font::Font**>(luaL_checkudata(L, 1, LUA_FONT)))->text_width(luaL_checkstring(L, 2)));
+	lua_pushnumber(L, luaL_checkfont(L, 1)->text_width(luaL_checkstring(L, 2)));
 	return 1;
 }
 
+static void lua_pushpath(lua_State* L, const std::vector<Font::Font::PathSegment>& segments, const double dx = 0, const double dy = 0) noexcept{
+	lua_createtable(L, segments.size() / 3, 0);	// Memory guess by expecting all segments are moves/lines
+	int table_i = 0;
+	for(size_t segment_i = 0; segment_i < segments.size(); ++segment_i){
+		const auto& segment = segments[segment_i];
+		switch(segment.type){
+			using Type = Font::Font::PathSegment::Type;
+			case Type::MOVE:
+				lua_pushstring(L, "m"); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.x + dx); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.y + dy); lua_rawseti(L, -2, ++table_i);
+				break;
+			case Type::LINE:
+				lua_pushstring(L, "l"); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.x + dx); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.y + dy); lua_rawseti(L, -2, ++table_i);
+				break;
+			case Type::CURVE:
+				lua_pushstring(L, "b"); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.x + dx); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segment.y + dy); lua_rawseti(L, -2, ++table_i);
+				assert(segment_i+2 < segments.size());
+				lua_pushnumber(L, segments[segment_i+1].x + dx); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segments[segment_i+1].y + dy); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segments[segment_i+2].x + dx); lua_rawseti(L, -2, ++table_i);
+				lua_pushnumber(L, segments[segment_i+2].y + dy); lua_rawseti(L, -2, ++table_i);
+				segment_i += 2;	// Skip 2 more for next loop pass
+				break;
+			case Type::CLOSE:
+				lua_pushstring(L, "c"); lua_rawseti(L, -2, ++table_i);
+				break;
+		}
+	}
+}
+
+void luaL_checkpath(lua_State* L, int arg, Geometry::PathSink& sink, const double dx, const double dy){
+	luaL_checktype(L, arg, LUA_TTABLE);
+	double p[6];
+	const auto numbers = [L,arg,&p,dx,dy](const int i, const int n) -> bool{
+		for(int j = 0; j < n; ++j){
+			lua_rawgeti(L, arg, i+j);
+			int isnum;
+			p[j] = lua_tonumberx(L, -1, &isnum) + (j & 1 ? dy : dx);
+			lua_pop(L, 1);
+			if(!isnum)
+				return false;
+		}
+		return true;
+	};
+	for(int i = 1, n = lua_rawlen(L, arg); i <= n;){
+		lua_rawgeti(L, arg, i++);
+		const char* cmd = lua_tostring(L, -1);
+		lua_pop(L, 1);
+		if(!cmd)
+			luaL_error(L, "Path command expected at index %d!", i-1);
+		switch(*cmd){
+			case 'm':
+				if(!numbers(i, 2))
+					luaL_error(L, "Invalid move at index %d!", i-1);
+				sink.move(p[0], p[1]);
+				i += 2;
+				break;
+			case 'l':
+				if(!numbers(i, 2))
+					luaL_error(L, "Invalid line at index %d!", i-1);
+				sink.line(p[0], p[1]);
+				i += 2;
+				break;
+			case 'b':
+				if(!numbers(i, 6))
+					luaL_error(L, "Invalid curve at index %d!", i-1);
+				sink.curve(p[0], p[1], p[2], p[3], p[4], p[5]);
+				i += 6;
+				break;
+			case 'c':
+				sink.close();
+				break;
+			default:
+				luaL_error(L, "Unknown path command '%s'!", cmd);
+		}
+	}
+}
+
 static int font_text_path(lua_State* L) noexcept{
 	try{
-		const std::vector<Font::Font::PathSegment> segments = (*static_cast<Font::Font**>(luaL_checkudata(L, 1, LUA_FONT)))->text_path(luaL_checkstring(L, 2));
-		lua_createtable(L, segments.size() / 3, 0);	// Memory guess by expecting all segments are moves/lines
-		int table_i = 0;
-		for(size_t segment_i = 0; segment_i < segments.size(); ++segment_i){
-			const auto& segment = segments[segment_i];
-			switch(segment.type){
-				using Type = Font::Font::PathSegment::Type;
-				case Type::MOVE:
-					lua_pushstring(L, "m"); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.x); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.y); lua_rawseti(L, -2, ++table_i);
-					break;
-				case Type::LINE:
-					lua_pushstring(L, "l"); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.x); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.y); lua_rawseti(L, -2, ++table_i);
-					break;
-				case Type::CURVE:
-					lua_pushstring(L, "b"); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.x); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segment.y); lua_rawseti(L, -2, ++table_i);
-					assert(segment_i+2 < segments.size());
-					lua_pushnumber(L, segments[segment_i+1].x); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segments[segment_i+1].y); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segments[segment_i+2].x); lua_rawseti(L, -2, ++table_i);
-					lua_pushnumber(L, segments[segment_i+2].y); lua_rawseti(L, -2, ++table_i);
-					segment_i += 2;	// Skip 2 more for next loop pass
-					break;
-				case Type::CLOSE:
-					lua_pushstring(L, "c"); lua_rawseti(L, -2, ++table_i);
-					break;
+		const std::vector<Font::Font::PathSegment> segments = luaL_checkfont(L, 1)->text_path(luaL_checkstring(L, 2));
+		if(lua_isnoneornil(L, 3)){
+			lua_pushpath(L, segments);
+			return 1;
+		}
+		// Flattened contours as packed points (x,y,...) for tesselation or vertex buffers
+		const std::vector<std::vector<Geometry::Point2d>> contours = Font::Font::flatten(segments, luaL_checknumber(L, 3));
+		lua_createtable(L, contours.size(), 0);
+		int i = 0;
+		for(const auto& contour : contours){
+			NumArray::Array* arr = new NumArray::Array(NumArray::Type::FLOAT64, contour.size() << 1);
+			double* points = arr->data<double>();
+			for(const auto& point : contour)
+				*points++ = point.x, *points++ = point.y;
+			lua_pushnumarray(L, arr);
+			lua_rawseti(L, -2, ++i);
+		}
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int font_glyphs(lua_State* L) noexcept{
+	// Get arguments
+	const Font::Font* font = luaL_checkfont(L, 1);
+	size_t text_len;
+	const char* text = luaL_checklstring(L, 2, &text_len);
+	const bool with_paths = lua_toboolean(L, 3);
+	// Send glyphs to Lua
+	try{
+		const std::string text_str(text, text_len);
+		const std::vector<Font::Font::Glyph> glyphs = font->glyphs(text_str);
+		lua_createtable(L, glyphs.size(), 0);
+		int i = 0;
+		for(const Font::Font::Glyph& glyph : glyphs){
+			lua_createtable(L, 0, with_paths ? 7 : 6);
+			lua_pushinteger(L, glyph.first + 1); lua_setfield(L, -2, "first");
+			lua_pushinteger(L, glyph.last); lua_setfield(L, -2, "last");
+			lua_pushnumber(L, glyph.x); lua_setfield(L, -2, "x");
+			lua_pushnumber(L, glyph.y); lua_setfield(L, -2, "y");
+			lua_pushnumber(L, glyph.advance); lua_setfield(L, -2, "advance");
+			lua_createtable(L, 0, 4);
+			lua_pushnumber(L, glyph.ink_x); lua_setfield(L, -2, "x");
+			lua_pushnumber(L, glyph.ink_y); lua_setfield(L, -2, "y");
+			lua_pushnumber(L, glyph.ink_width); lua_setfield(L, -2, "width");
+			lua_pushnumber(L, glyph.ink_height); lua_setfield(L, -2, "height");
+			lua_setfield(L, -2, "ink");
+			if(with_paths){
+				// Cluster outline (cached per cluster text) moved to its position (single line baseline equals first one)
+				lua_pushpath(L, font->text_path(text_str.substr(glyph.first, glyph.last - glyph.first)), glyph.x, glyph.y - glyphs.front().y);
+				lua_setfield(L, -2, "path");
+			}
+			lua_rawseti(L, -2, ++i);
+		}
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int font_layout(lua_State* L) noexcept{
+	// Get arguments
+	const Font::Font* font = luaL_checkfont(L, 1);
+	size_t text_len;
+	const char* text = luaL_checklstring(L, 2, &text_len);
+	luaL_argcheck(L, lua_isnoneornil(L, 3) || lua_istable(L, 3), 3, "optional table expected");
+	double width = 0, spacing = 0;
+	Font::Font::Align align = Font::Font::Align::LEFT;
+	Font::Font::Wrap wrap = Font::Font::Wrap::WORD;
+	if(lua_istable(L, 3)){
+		static const char* align_str[] = {"left", "center", "right", "justify", nullptr};
+		static const Font::Font::Align align_enum[] = {Font::Font::Align::LEFT, Font::Font::Align::CENTER, Font::Font::Align::RIGHT, Font::Font::Align::JUSTIFY};
+		static const char* wrap_str[] = {"word", "char", "wordchar", "none", nullptr};
+		static const Font::Font::Wrap wrap_enum[] = {Font::Font::Wrap::WORD, Font::Font::Wrap::CHAR, Font::Font::Wrap::WORD_CHAR, Font::Font::Wrap::NONE};
+		lua_getfield(L, 3, "width"); width = luaL_optnumber(L, -1, width);
+		lua_getfield(L, 3, "align"); align = align_enum[luaL_checkoption(L, -1, "left", align_str)];
+		lua_getfield(L, 3, "wrap"); wrap = wrap_enum[luaL_checkoption(L, -1, "word", wrap_str)];
+		lua_getfield(L, 3, "spacing"); spacing = luaL_optnumber(L, -1, spacing);
+		lua_pop(L, 4);
+	}
+	if(width < 0)
+		return luaL_error(L, "Invalid width!");
+	// Send lines to Lua
+	try{
+		const std::vector<Font::Font::Line> lines = font->layout(std::string(text, text_len), width, align, wrap, spacing);
+		lua_createtable(L, lines.size(), 0);
+		int i = 0;
+		for(const Font::Font::Line& line : lines){
+			lua_createtable(L, 0, 5);
+			lua_pushinteger(L, line.first + 1); lua_setfield(L, -2, "first");
+			lua_pushinteger(L, line.last); lua_setfield(L, -2, "last");
+			lua_pushnumber(L, line.x); lua_setfield(L, -2, "x");
+			lua_pushnumber(L, line.y); lua_setfield(L, -2, "y");
+			lua_pushnumber(L, line.width); lua_setfield(L, -2, "width");
+			lua_rawseti(L, -2, ++i);
+		}
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int font_atlas(lua_State* L) noexcept{
+	// Get arguments
+	const Font::Font* font = luaL_checkfont(L, 1);
+	size_t chars_len;
+	const char* chars = luaL_checklstring(L, 2, &chars_len);
+	luaL_argcheck(L, lua_isnoneornil(L, 3) || lua_istable(L, 3), 3, "optional table expected");
+	double scale = 1, spread = 4, tolerance = 0.1;
+	int max_width = 1024;
+	if(lua_istable(L, 3)){
+		lua_getfield(L, 3, "scale"); scale = luaL_optnumber(L, -1, scale);
+		lua_getfield(L, 3, "spread"); spread = luaL_optnumber(L, -1, spread);
+		lua_getfield(L, 3, "tolerance"); tolerance = luaL_optnumber(L, -1, tolerance);
+		lua_getfield(L, 3, "width"); max_width = luaL_optinteger(L, -1, max_width);
+		lua_pop(L, 4);
+		lua_getfield(L, 3, "texture");
+	}else
+		lua_pushnil(L);
+	const int texture = lua_gettop(L);
+	if(!(scale > 0 && spread > 0 && tolerance > 0 && max_width > 0 && 2 * std::ceil(spread) <= max_width))
+		return luaL_error(L, "Invalid scale, spread, tolerance or width!");
+	// Glyph outlines of unique characters (in atlas pixels)
+	struct AtlasGlyph{
+		std::string chr;
+		std::vector<SDF::Contour> contours;
+		int left, top, width, height, x, y;
+		double advance;
+	};
+	std::vector<AtlasGlyph> glyphs;
+	const int padding = std::ceil(spread);
+	try{
+		for(size_t i = 0; i < chars_len;){
+			const unsigned char lead = chars[i];
+			const size_t chr_len = std::min(chars_len - i, static_cast<size_t>(lead < 0x80 ? 1 : lead >> 5 == 0x6 ? 2 : lead >> 4 == 0xe ? 3 : lead >> 3 == 0x1e ? 4 : 1));
+			const std::string chr(chars + i, chr_len);
+			i += chr_len;
+			if(std::any_of(glyphs.begin(), glyphs.end(), [&chr](const AtlasGlyph& glyph){return glyph.chr == chr;}))
+				continue;
+			AtlasGlyph glyph{chr, Font::Font::flatten(font->text_path(chr), tolerance / scale), 0, 0, 2 * padding, 2 * padding, 0, 0, font->text_width(chr)};
+			if(!glyph.contours.empty()){
+				double min_x = std::numeric_limits<double>::max(), min_y = min_x, max_x = -min_x, max_y = -min_x;
+				for(auto& contour : glyph.contours)
+					for(auto& point : contour){
+						point.x *= scale, point.y *= scale;
+						min_x = std::min(min_x, point.x), min_y = std::min(min_y, point.y), max_x = std::max(max_x, point.x), max_y = std::max(max_y, point.y);
+					}
+				// Cell bounds in integer range (before any conversion)
+				const double left = std::floor(min_x) - padding, top = std::floor(min_y) - padding,
+					right = std::ceil(max_x) + padding, bottom = std::ceil(max_y) + padding;
+				if(!(left >= INT_MIN && top >= INT_MIN && right <= INT_MAX && bottom <= INT_MAX && right - left <= max_width && bottom - top <= INT_MAX))
+					throw std::length_error("Glyph doesn't fit into atlas width!");
+				glyph.left = left, glyph.top = top;
+				glyph.width = right - left, glyph.height = bottom - top;
 			}
+			glyphs.push_back(std::move(glyph));
 		}
-	}catch(const Font::exception& e){
+	}catch(const std::exception& e){
 		return luaL_error(L, e.what());
 	}
+	// Pack cells in shelves, tallest first
+	std::vector<AtlasGlyph*> order;
+	for(auto& glyph : glyphs)
+		order.push_back(&glyph);
+	std::stable_sort(order.begin(), order.end(), [](const AtlasGlyph* a, const AtlasGlyph* b){return a->height > b->height;});
+	int atlas_width = 0, atlas_height = 0, shelf_x = 0, shelf_height = 0;
+	for(AtlasGlyph* glyph : order){
+		if(glyph->width > max_width)
+			return luaL_error(L, "Glyph doesn't fit into atlas width!");
+		if(glyph->width > max_width - shelf_x){
+			if(shelf_height > INT_MAX - atlas_height)
+				return luaL_error(L, "Atlas too large!");
+			atlas_height += shelf_height, shelf_x = shelf_height = 0;
+		}
+		glyph->x = shelf_x, glyph->y = atlas_height;
+		shelf_x += glyph->width, shelf_height = std::max(shelf_height, glyph->height);
+		atlas_width = std::max(atlas_width, shelf_x);
+	}
+	if(shelf_height > INT_MAX - atlas_height)
+		return luaL_error(L, "Atlas too large!");
+	atlas_height += shelf_height;
+	// Render distance fields into texture (BGR with equal channels) or single-channel string
+	const size_t atlas_size = static_cast<size_t>(atlas_width) * atlas_height;
+	std::string data;
+	unsigned char* pixels;
+	unsigned channels;
+	if(lua_isnil(L, texture)){
+		try{
+			data.resize(atlas_size);
+		}catch(const std::exception&){
+			return luaL_error(L, "Not enough memory!");
+		}
+		pixels = reinterpret_cast<unsigned char*>(const_cast<char*>(data.data())), channels = 1;
+	}else if((pixels = lua_texture_map(L, texture, atlas_width, atlas_height, false)))
+		channels = 3, std::fill(pixels, pixels + atlas_size * channels, 0);
+	else
+		return luaL_error(L, "Texture expected with active context!");
+	for(const auto& glyph : glyphs)
+		SDF::render(glyph.contours, glyph.left, glyph.top, spread,
+			pixels + (static_cast<size_t>(glyph.y) * atlas_width + glyph.x) * channels, glyph.width, glyph.height, static_cast<ptrdiff_t>(atlas_width) * channels, channels);
+	if(!lua_isnil(L, texture) && !lua_texture_unmap(L, texture))
+		return luaL_error(L, "Couldn't upload texture data!");
+	// Send atlas informations to Lua
+	lua_pushinteger(L, atlas_width);
+	lua_pushinteger(L, atlas_height);
+	lua_createtable(L, 0, glyphs.size());
+	for(const auto& glyph : glyphs){
+		lua_createtable(L, 0, 11);
+		lua_pushinteger(L, glyph.x); lua_setfield(L, -2, "x");
+		lua_pushinteger(L, glyph.y); lua_setfield(L, -2, "y");
+		lua_pushinteger(L, glyph.width); lua_setfield(L, -2, "width");
+		lua_pushinteger(L, glyph.height); lua_setfield(L, -2, "height");
+		lua_pushnumber(L, static_cast<double>(glyph.x) / atlas_width); lua_setfield(L, -2, "u0");
+		lua_pushnumber(L, static_cast<double>(glyph.y) / atlas_height); lua_setfield(L, -2, "v0");
+		lua_pushnumber(L, static_cast<double>(glyph.x + glyph.width) / atlas_width); lua_setfield(L, -2, "u1");
+		lua_pushnumber(L, static_cast<double>(glyph.y + glyph.height) / atlas_height); lua_setfield(L, -2, "v1");
+		lua_pushnumber(L, glyph.left / scale); lua_setfield(L, -2, "offset_x");
+		lua_pushnumber(L, glyph.top / scale); lua_setfield(L, -2, "offset_y");
+		lua_pushnumber(L, glyph.advance); lua_setfield(L, -2, "advance");
+		lua_setfield(L, -2, glyph.chr.c_str());
+	}
+	if(data.empty())
+		return 3;
+	lua_pushlstring(L, data.data(), data.length());
+	return 4;
+}
+
+static int font_cache(lua_State* L) noexcept{
+	Font::Font* font = luaL_checkfont(L, 1);
+	// Set cache size
+	if(!lua_isnoneornil(L, 2)){
+		const lua_Integer size = luaL_checkinteger(L, 2);
+		luaL_argcheck(L, size > 0, 2, "size must be positive");
+		font->set_cache_size(size);
+	}
+	// Get statistics
+	const Font::Font::CacheStats stats = font->cache_stats();
+	lua_createtable(L, 0, 5);
+	lua_pushinteger(L, stats.hits); lua_setfield(L, -2, "hits");
+	lua_pushinteger(L, stats.misses); lua_setfield(L, -2, "misses");
+	lua_pushnumber(L, stats.hits + stats.misses ? static_cast<double>(stats.hits) / (stats.hits + stats.misses) : 0); lua_setfield(L, -2, "hit_rate");
+	lua_pushinteger(L, stats.entries); lua_setfield(L, -2, "entries");
+	lua_pushinteger(L, stats.capacity); lua_setfield(L, -2, "capacity");
 	return 1;
 }
 
 static int font_create(lua_State* L) noexcept{
 	try{
-		Font::Font font(luaL_checkstring(L, 1), luaL_optnumber(L, 2, 12),
+		const std::shared_ptr<Font::Font> font = Font::pool().get(luaL_checkstring(L, 1), luaL_optnumber(L, 2, 12),
 					luaL_optboolean(L, 3, false), luaL_optboolean(L, 4, false), luaL_optboolean(L, 5, false), luaL_optboolean(L, 6, false),
 					luaL_optnumber(L, 7, 0), luaL_optboolean(L, 8, false));
-		*static_cast<Font::Font**>(lua_newuserdata(L, sizeof(Font::Font*))) = new Font::Font(std::move(font));
-	}catch(const Font::exception& e){
+		*static_cast<std::shared_ptr<Font::Font>**>(lua_newuserdata(L, sizeof(std::shared_ptr<Font::Font>*))) = new std::shared_ptr<Font::Font>(font);
+	}catch(const std::exception& e){
 		return luaL_error(L, e.what());
 	}
 	if(luaL_newmetatable(L, LUA_FONT)){
@@ -128,6 +447,10 @@ static int font_create(lua_State* L) noexcept{
 			{"metrics", font_metrics},
 			{"textwidth", font_text_width},
 			{"textpath", font_text_path},
+			{"glyphs", font_glyphs},
+			{"layout", font_layout},
+			{"atlas", font_atlas},
+			{"cache", font_cache},
 			{NULL, NULL}
 		};
 		luaL_setfuncs(L, l, 0);
@@ -137,10 +460,17 @@ static int font_create(lua_State* L) noexcept{
 	return 1;
 }
 
+static int font_clear_pool(lua_State*) noexcept{
+	Font::pool().clear();
+	return 0;
+}
+
 int luaopen_font(lua_State* L)/* No exception specifier because of C declaration */{
 	static const luaL_Reg l[] = {
 		{"list", font_list},
+		{"find", font_find},
 		{"create", font_create},
+		{"clearpool", font_clear_pool},
 		{NULL, NULL}
 	};
 	luaL_newlib(L, l);
@@ -15,6 +15,7 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "libs.h"
 #include "../utils/lua.h"
 #include "../utils/math.hpp"
+#include "../utils/numarray.hpp"
 #include <GL/glu.h>
 #include <memory>
 #include <cassert>
@@ -53,7 +54,38 @@ static int geometry_direction(lua_State* L) noexcept{
 	return 1;
 }
 
+template<typename T>
+static void bound(const T* points, const size_t n, double& min_x, double& min_y, double& max_x, double& max_y) noexcept{
+	min_x = max_x = points[0], min_y = max_y = points[1];
+	for(size_t i = 2; i < n; i += 2){
+		const double x = points[i], y = points[i+1];
+		if(x < min_x) min_x = x;
+		else if(x > max_x) max_x = x;
+		if(y < min_y) min_y = y;
+		else if(y > max_y) max_y = y;
+	}
+}
 static int geometry_bound(lua_State* L) noexcept{
+	// Points by numeric array
+	const NumArray::Array* arr = lua_tonumarray(L, 1);
+	if(arr){
+		const size_t n = arr->size() & ~0x1;	// Size as multiple of 2
+		if(n != 0){
+			double min_x, min_y, max_x, max_y;
+			switch(arr->get_type()){
+				case NumArray::Type::FLOAT32: bound(arr->data<float>(), n, min_x, min_y, max_x, max_y); break;
+				case NumArray::Type::FLOAT64: bound(arr->data<double>(), n, min_x, min_y, max_x, max_y); break;
+				case NumArray::Type::INT32: bound(arr->data<int32_t>(), n, min_x, min_y, max_x, max_y); break;
+			}
+			lua_pushnumber(L, min_x);
+			lua_pushnumber(L, min_y);
+			lua_pushnumber(L, max_x);
+			lua_pushnumber(L, max_y);
+			return 4;
+		}
+		return 0;
+	}
+	// Points by table
 	luaL_checktype(L, 1, LUA_TTABLE);
 	const size_t n = lua_rawlen(L, 1) & ~0x1;	// Size as multiple of 2
 	if(n != 0){
@@ -153,18 +185,25 @@ static void APIENTRY tess_error_callback(GLenum err, void* userdata) noexcept{
 static int geometry_tesselate(lua_State* L) noexcept{
 	// Check argument
 	luaL_checktype(L, 1, LUA_TTABLE);
-	// Get argument (table) as contours of 2d/fake-3d points
+	// Get argument (table) as contours (tables or numeric arrays) of 2d/fake-3d points
 	std::vector<std::vector<std::array<double,3>>> contours(lua_rawlen(L, 1));
 	for(size_t contour_i = 0; contour_i < contours.size(); ++contour_i){
 		std::vector<std::array<double,3>>& points = contours[contour_i];
 		lua_rawgeti(L, 1, 1+contour_i);
-		luaL_checktype(L, -1, LUA_TTABLE);
-		points.resize(lua_rawlen(L, -1) >> 1);
-		int i = 0;
-		for(auto& point : points){
-			lua_rawgeti(L, -1, ++i); lua_rawgeti(L, -2, ++i);
-			point = {luaL_checknumber(L, -2), luaL_checknumber(L, -1), 0};
-			lua_pop(L, 2);
+		const NumArray::Array* arr = lua_tonumarray(L, -1);
+		if(arr){
+			points.resize(arr->size() >> 1);
+			for(size_t i = 0; i < points.size(); ++i)
+				points[i] = {arr->get(i << 1), arr->get((i << 1) + 1), 0};
+		}else{
+			luaL_checktype(L, -1, LUA_TTABLE);
+			points.resize(lua_rawlen(L, -1) >> 1);
+			int i = 0;
+			for(auto& point : points){
+				lua_rawgeti(L, -1, ++i); lua_rawgeti(L, -2, ++i);
+				point = {luaL_checknumber(L, -2), luaL_checknumber(L, -1), 0};
+				lua_pop(L, 2);
+			}
 		}
 		lua_pop(L, 1);
 	}
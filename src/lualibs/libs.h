@@ -25,3 +25,36 @@ int luaopen_png(lua_State* L);
 int luaopen_tgl(lua_State* L);
 int luaopen_font(lua_State* L);
 int luaopen_utf8x(lua_State* L);
+int luaopen_numarray(lua_State* L);
+int luaopen_canvas(lua_State* L);
+
+// Numeric array userdata access for other libraries (NULL if argument isn't one)
+namespace NumArray{class Array;}
+NumArray::Array* lua_tonumarray(lua_State* L, int arg) noexcept;
+void lua_pushnumarray(lua_State* L, NumArray::Array* arr) noexcept;	// Takes ownership
+
+// Byte data access of strings & memory-mapped files for other libraries (NULL if argument is neither)
+const char* lua_tobytes(lua_State* L, int arg, size_t* len) noexcept;
+
+// Image memory access for other libraries: canvas or host frame (false if argument is neither)
+namespace Image{struct View; class Canvas;}
+Image::Canvas* lua_tocanvas(lua_State* L, int arg) noexcept;
+void lua_pushcanvas(lua_State* L, Image::Canvas* canvas) noexcept;	// Takes ownership
+bool lua_toimage(lua_State* L, int arg, Image::View& view) noexcept;
+bool lua_toframe(lua_State* L, int arg, Image::View& view) noexcept;	// Defined with frame userdata (main)
+
+// Font userdata access for other libraries (NULL if argument isn't one)
+namespace Font{class Font;}
+Font::Font* lua_tofont(lua_State* L, int arg) noexcept;
+// Path table like font:textpath output (m/l/b/c and numbers) walked into receiver, moved by offset (Lua error on malformed commands)
+namespace Geometry{class PathSink;}
+void luaL_checkpath(lua_State* L, int arg, Geometry::PathSink& sink, double dx = 0, double dy = 0);
+
+#ifndef _WIN32
+// Cairo drawing context over image memory (canvas or frame), returns number of pushed values
+int lua_pushcairo(lua_State* L, int arg) noexcept;
+#endif
+
+// Texture pixel upload through mapped buffer for other libraries (NULL if argument isn't a texture or mapping failed)
+unsigned char* lua_texture_map(lua_State* L, int arg, unsigned width, unsigned height, bool has_alpha) noexcept;
+bool lua_texture_unmap(lua_State* L, int arg) noexcept;
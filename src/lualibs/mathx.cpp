@@ -15,6 +15,7 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "libs.h"
 #include "../utils/lua.h"
 #include "../utils/math.hpp"
+#include "../utils/numarray.hpp"
 #include <complex>
 #include <algorithm>
 
@@ -312,6 +313,18 @@ static int math_fac(lua_State* L) noexcept{
 static int math_bezier(lua_State* L) noexcept{
 	const double pct = luaL_checknumber(L, 1),
 		pct_inv = 1 - pct;
+	// Control values by numeric array
+	const NumArray::Array* arr = lua_tonumarray(L, 2);
+	if(arr){
+		if(arr->size() == 0)
+			return 0;
+		double result = 0;
+		for(int i = 0, n = arr->size()-1; i <= n; ++i)
+			result += arr->get(i) * Math::bernstein(i, n, pct);
+		lua_pushnumber(L, result);
+		return 1;
+	}
+	// Control values by arguments
 	const int top = lua_gettop(L);
 	switch(top-1){
 		case 0: lua_pushnil(L); break;
@@ -0,0 +1,280 @@
+/*
+Project: FLuaG
+File: numarray.cpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "libs.h"
+#include "../utils/lua.h"
+#include "../utils/numarray.hpp"
+
+// Unique name for Lua metatable
+#define LUA_NUMARRAY "numarray"
+
+using NumArray::Array;
+
+NumArray::Array* lua_tonumarray(lua_State* L, int arg) noexcept{
+	Array** udata = static_cast<Array**>(luaL_testudata(L, arg, LUA_NUMARRAY));
+	return udata ? *udata : nullptr;
+}
+
+// Helpers
+static Array* luaL_checknumarray(lua_State* L, int arg) noexcept{
+	return *static_cast<Array**>(luaL_checkudata(L, arg, LUA_NUMARRAY));
+}
+
+static void lua_pushelement(lua_State* L, const Array* arr, const size_t i) noexcept{
+	if(arr->get_type() == NumArray::Type::INT32)
+		lua_pushinteger(L, arr->data<int32_t>()[i]);
+	else
+		lua_pushnumber(L, arr->get(i));
+}
+
+static int numarray_arithmetic(lua_State* L, const NumArray::Op op) noexcept{
+	Array* arr = luaL_checknumarray(L, 1);
+	try{
+		if(lua_isnumber(L, 2))
+			arr->apply(op, lua_tonumber(L, 2));
+		else
+			arr->apply(op, *luaL_checknumarray(L, 2));
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+// Numarray metatable methods
+static int numarray_free(lua_State* L) noexcept{
+	delete luaL_checknumarray(L, 1);
+	return 0;
+}
+
+static int numarray_len(lua_State* L) noexcept{
+	lua_pushinteger(L, luaL_checknumarray(L, 1)->size());
+	return 1;
+}
+
+static int numarray_index(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	if(lua_type(L, 2) == LUA_TNUMBER){
+		const lua_Integer i = lua_tointeger(L, 2);
+		if(i >= 1 && static_cast<size_t>(i) <= arr->size()){
+			lua_pushelement(L, arr, i-1);
+			return 1;
+		}
+		return 0;
+	}
+	// Fallback to methods (upvalue table, metamethods stay unreachable)
+	lua_pushvalue(L, 2);
+	lua_rawget(L, lua_upvalueindex(1));
+	return 1;
+}
+
+static int numarray_newindex(lua_State* L) noexcept{
+	Array* arr = luaL_checknumarray(L, 1);
+	const lua_Integer i = luaL_checkinteger(L, 2);
+	luaL_argcheck(L, i >= 1 && static_cast<size_t>(i) <= arr->size(), 2, "index out of range");
+	arr->set(i-1, luaL_checknumber(L, 3));
+	return 0;
+}
+
+static int numarray_tostring(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	static const char* type_str[] = {"float32", "float64", "int32"};
+	lua_pushfstring(L, "numarray(%s,%d): %p", type_str[static_cast<int>(arr->get_type())], static_cast<int>(arr->size()), arr->data());
+	return 1;
+}
+
+static int numarray_type(lua_State* L) noexcept{
+	switch(luaL_checknumarray(L, 1)->get_type()){
+		case NumArray::Type::FLOAT32: lua_pushstring(L, "float32"); break;
+		case NumArray::Type::FLOAT64: lua_pushstring(L, "float64"); break;
+		case NumArray::Type::INT32: lua_pushstring(L, "int32"); break;
+	}
+	return 1;
+}
+
+static int numarray_add(lua_State* L) noexcept{
+	return numarray_arithmetic(L, NumArray::Op::ADD);
+}
+
+static int numarray_sub(lua_State* L) noexcept{
+	return numarray_arithmetic(L, NumArray::Op::SUB);
+}
+
+static int numarray_mul(lua_State* L) noexcept{
+	return numarray_arithmetic(L, NumArray::Op::MUL);
+}
+
+static int numarray_div(lua_State* L) noexcept{
+	return numarray_arithmetic(L, NumArray::Op::DIV);
+}
+
+static int numarray_sum(lua_State* L) noexcept{
+	lua_pushnumber(L, luaL_checknumarray(L, 1)->sum());
+	return 1;
+}
+
+static int numarray_min(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	if(arr->size() == 0)
+		return 0;
+	lua_pushnumber(L, arr->minmax().first);
+	return 1;
+}
+
+static int numarray_max(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	if(arr->size() == 0)
+		return 0;
+	lua_pushnumber(L, arr->minmax().second);
+	return 1;
+}
+
+static int numarray_minmax(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	if(arr->size() == 0)
+		return 0;
+	const auto minmax = arr->minmax();
+	lua_pushnumber(L, minmax.first);
+	lua_pushnumber(L, minmax.second);
+	return 2;
+}
+
+static int numarray_fill(lua_State* L) noexcept{
+	Array* arr = luaL_checknumarray(L, 1);
+	const double value = luaL_checknumber(L, 2);
+	const lua_Integer first = luaL_optinteger(L, 3, 1),
+		count = luaL_optinteger(L, 4, static_cast<lua_Integer>(arr->size()) - first + 1);
+	luaL_argcheck(L, first >= 1, 3, "index out of range");
+	luaL_argcheck(L, count >= 0, 4, "negative count");
+	try{
+		arr->fill(value, first-1, count);
+	}catch(const std::out_of_range& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int numarray_copy(lua_State* L) noexcept{
+	Array* dst = luaL_checknumarray(L, 1);
+	const Array* src = luaL_checknumarray(L, 2);
+	const lua_Integer src_first = luaL_optinteger(L, 3, 1),
+		count = luaL_optinteger(L, 4, static_cast<lua_Integer>(src->size()) - src_first + 1),
+		dst_first = luaL_optinteger(L, 5, 1);
+	luaL_argcheck(L, src_first >= 1, 3, "index out of range");
+	luaL_argcheck(L, count >= 0, 4, "negative count");
+	luaL_argcheck(L, dst_first >= 1, 5, "index out of range");
+	try{
+		dst->copy(*src, src_first-1, count, dst_first-1);
+	}catch(const std::out_of_range& e){
+		return luaL_error(L, e.what());
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int numarray_clone(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	try{
+		lua_pushnumarray(L, new Array(*arr));
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}
+	return 1;
+}
+
+static int numarray_totable(lua_State* L) noexcept{
+	const Array* arr = luaL_checknumarray(L, 1);
+	const lua_Integer first = luaL_optinteger(L, 2, 1),
+		count = luaL_optinteger(L, 3, static_cast<lua_Integer>(arr->size()) - first + 1);
+	luaL_argcheck(L, first >= 1, 2, "index out of range");
+	luaL_argcheck(L, count >= 0 && static_cast<size_t>(first-1+count) <= arr->size(), 3, "count out of range");
+	lua_createtable(L, count, 0);
+	for(lua_Integer i = 0; i < count; ++i){
+		lua_pushelement(L, arr, first-1+i);
+		lua_rawseti(L, -2, i+1);
+	}
+	return 1;
+}
+
+void lua_pushnumarray(lua_State* L, Array* arr) noexcept{
+	*static_cast<Array**>(lua_newuserdata(L, sizeof(Array*))) = arr;
+	if(luaL_newmetatable(L, LUA_NUMARRAY)){
+		static const luaL_Reg meta[] = {
+			{"__gc", numarray_free},
+			{"__len", numarray_len},
+			{"__newindex", numarray_newindex},
+			{"__tostring", numarray_tostring},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"type", numarray_type},
+			{"add", numarray_add},
+			{"sub", numarray_sub},
+			{"mul", numarray_mul},
+			{"div", numarray_div},
+			{"sum", numarray_sum},
+			{"min", numarray_min},
+			{"max", numarray_max},
+			{"minmax", numarray_minmax},
+			{"fill", numarray_fill},
+			{"copy", numarray_copy},
+			{"clone", numarray_clone},
+			{"totable", numarray_totable},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods);
+		lua_pushcclosure(L, numarray_index, 1); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+}
+
+// General functions
+static int numarray_create(lua_State* L) noexcept{
+	// Get arguments
+	static const char* option_str[] = {"float32", "float64", "int32", nullptr};
+	static const NumArray::Type option_enum[] = {NumArray::Type::FLOAT32, NumArray::Type::FLOAT64, NumArray::Type::INT32};
+	const NumArray::Type type = option_enum[luaL_checkoption(L, 1, nullptr, option_str)];
+	const bool from_table = lua_istable(L, 2);
+	const lua_Integer n = from_table ? static_cast<lua_Integer>(lua_rawlen(L, 2)) : luaL_checkinteger(L, 2);
+	luaL_argcheck(L, n >= 0, 2, "negative size");
+	// Create array
+	Array* arr;
+	try{
+		arr = new Array(type, n);
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}
+	lua_pushnumarray(L, arr);	// Owns array from now on
+	// Fill array by table
+	if(from_table)
+		for(lua_Integer i = 1; i <= n; ++i){
+			lua_rawgeti(L, 2, i);
+			if(!lua_isnumber(L, -1))
+				return luaL_error(L, "Table must contain numbers only!");
+			arr->set(i-1, lua_tonumber(L, -1));
+			lua_pop(L, 1);
+		}
+	return 1;
+}
+
+int luaopen_numarray(lua_State* L)/* No exception specifier because of C declaration */{
+	static const luaL_Reg l[] = {
+		{"create", numarray_create},
+		{NULL, NULL}
+	};
+	luaL_newlib(L, l);
+	return 1;
+}
@@ -14,57 +14,120 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #include "libs.h"
 #include "../utils/lua.h"
+#include "../utils/pngio.hpp"
+#include "../utils/image.hpp"
 #include <sstream>
 #include <fstream>
 #include <png.h>
 #include <memory>
-#include <cassert>
-
-static int png_decode(std::istream& in, lua_State* L) noexcept{
-	// Check PNG signature
-	static const unsigned PNG_SIG_BYTES = 8;
-	unsigned char png_sig[PNG_SIG_BYTES];
-	if(!in.read(reinterpret_cast<char*>(png_sig), PNG_SIG_BYTES))
-		return luaL_error(L, "Couldn't read signature from file!");
-	if(!png_check_sig(png_sig, PNG_SIG_BYTES))
-		return luaL_error(L, "File signature isn't PNG!");
-	// Create PNG structures
-	png_infop png_info = nullptr;
-	const std::unique_ptr<png_struct,std::function<void(png_structp)>> png(png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr), [&png_info](png_structp png){png_destroy_read_struct(&png, &png_info, nullptr);});
-	if(!png || !(png_info = png_create_info_struct(png.get())))
-		return luaL_error(L, "Couldn't create PNG structures!");
-	// Set PNG error "handler"
-	if(setjmp(png_jmpbuf(png.get())))
-		return luaL_error(L, "PNG read error occured!");
-	// Set PNG source reader
-	png_set_read_fn(png.get(), &in, [](png_structp png, png_bytep out, png_size_t out_size){
-		if(!static_cast<std::istream*>(png_get_io_ptr(png))->read(reinterpret_cast<char*>(out), out_size))
-			longjmp(png_jmpbuf(png), 1);
-	});
-	png_set_sig_bytes(png.get(), PNG_SIG_BYTES);
-	// Read PNG header informations
-	png_read_info(png.get(), png_info);
-	png_uint_32 width, height;
-	int color_type;
-	if(!png_get_IHDR(png.get(), png_info, &width, &height, nullptr, &color_type, nullptr, nullptr, nullptr))
-		return luaL_error(L, "Couldn't read PNG header!");
-	// Set PNG image transformations
-	png_set_expand(png.get());			// Converts PALETTE->RGB24, GREY?->GREY8, RNG_CHUNK->ALPHA
-	png_set_strip_16(png.get());			// Converts RGB48->RGB24, GREY16->GREY8
-	png_set_gray_to_rgb(png.get());			// Converts GREY->RGB
-	png_read_update_info(png.get(), png_info);	// Update header to new format after conversions
-	// Read PNG image
-	const png_size_t rowbytes = png_get_rowbytes(png.get(), png_info);
-	std::string data(height * rowbytes, '\0');
-	png_bytep pdata = reinterpret_cast<png_bytep>(const_cast<char*>(data.data()));
-	for(const png_bytep data_end = pdata + height * rowbytes; pdata != data_end; pdata += rowbytes)
-		png_read_row(png.get(), pdata, nullptr);
-	// Send PNG data to Lua
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// Unique name for Lua metatable
+#define LUA_PNG_SEQUENCE "png_sequence"
+#define LUA_PNG_WRITER "png_writer"
+
+// Writes decoded image (by callback for target view, position, premultiplication & BGR order) into image view, texture at target index or packed rows.
+// Returns error message instead of raising, so callers can leave their C++ resources first.
+typedef std::function<void(const Image::View&, int, int, bool, bool)> PNGSource;
+static const char* png_output(lua_State* L, const unsigned width, const unsigned height, const bool has_alpha, const int x, const int y, const bool premultiply,
+		Image::View* image, const int texture, std::string& packed, const PNGSource& source){
+	if(image){
+		image->premultiplied |= premultiply;
+		source(*image, x, y, image->premultiplied, true);
+	}else if(texture){
+		unsigned char* pbo_data = lua_texture_map(L, texture, width, height, has_alpha);
+		if(!pbo_data)
+			return "Target must be a canvas, frame or texture with active context!";
+		try{
+			source({pbo_data, width, height, static_cast<ptrdiff_t>(width * (has_alpha ? 4 : 3)), has_alpha, premultiply}, 0, 0, premultiply, true);
+		}catch(...){
+			lua_texture_unmap(L, texture);
+			throw;
+		}
+		if(!lua_texture_unmap(L, texture))
+			return "Couldn't upload texture data!";
+	}else{
+		const size_t rowsize = static_cast<size_t>(width) * (has_alpha ? 4 : 3);
+		packed.assign(height * rowsize, '\0');
+		source({reinterpret_cast<unsigned char*>(const_cast<char*>(packed.data())), width, height, static_cast<ptrdiff_t>(rowsize), has_alpha, premultiply}, 0, 0, premultiply, false);
+	}
+	return nullptr;
+}
+
+static int png_decode(lua_State* L, const char* filename, const unsigned char* data, size_t len, const int options) noexcept{
+	// Get options
+	luaL_argcheck(L, lua_isnoneornil(L, options) || lua_istable(L, options), options, "optional table expected");
+	int x = 0, y = 0, scale = 1;
+	bool premultiply = false, cache = false;	// Caching pays off for repeated reads only, decoding into target saves the copy
+	if(lua_istable(L, options)){
+		lua_getfield(L, options, "x"); x = luaL_optinteger(L, -1, x);
+		lua_getfield(L, options, "y"); y = luaL_optinteger(L, -1, y);
+		lua_getfield(L, options, "scale"); scale = luaL_optinteger(L, -1, scale);
+		lua_getfield(L, options, "premultiply"); premultiply = luaL_optboolean(L, -1, premultiply);
+		lua_getfield(L, options, "cache"); cache = luaL_optboolean(L, -1, cache);
+		lua_pop(L, 5);
+		lua_getfield(L, options, "target");
+	}else
+		lua_pushnil(L);
+	const int target = lua_gettop(L);
+	if(scale < 1 || scale > 16)
+		return luaL_error(L, "Invalid scale!");
+	// Resolve target before any C++ resources (Lua errors would skip their destruction)
+	Image::View image;
+	const bool has_image = lua_toimage(L, target, image);
+	const int texture = has_image || lua_isnil(L, target) ? 0 : target;
+	// Decode into target or packed rows
+	unsigned width, height;
+	bool has_alpha;
+	std::string packed;
+	const char* error;
+	try{
+		if(filename && cache){
+			// Copy from shared decoded file
+			const std::shared_ptr<const Image::Buffer> buffer = PNG::cache().get(filename, scale);
+			width = buffer->get_width(), height = buffer->get_height(), has_alpha = buffer->get_has_alpha();
+			error = png_output(L, width, height, has_alpha, x, y, premultiply, has_image ? &image : nullptr, texture, packed,
+				[&buffer](const Image::View& target, const int x, const int y, const bool premultiply, const bool bgr){
+					Image::View src = buffer->view();
+					const Image::View dst = target.sub(x, y, src.width, src.height);
+					src.premultiplied = !dst.has_alpha && !premultiply;	// Drop alpha without blending like decoder
+					Image::copy(src.sub(std::max(0, -x), std::max(0, -y), dst.width, dst.height), {dst.data, dst.width, dst.height, dst.stride, dst.has_alpha, premultiply});
+					if(!bgr)
+						for(unsigned row = 0; row < dst.height; ++row)
+							for(unsigned char* pixel = dst.row(row), *const row_end = pixel + dst.width * dst.channels(); pixel != row_end; pixel += dst.channels())
+								std::swap(pixel[0], pixel[2]);
+				});
+		}else{
+			// Decode directly into target
+			std::unique_ptr<boost::interprocess::mapped_region> region;
+			if(filename){
+				region = PNG::map_file(filename);
+				data = static_cast<const unsigned char*>(region->get_address()), len = region->get_size();
+			}
+			PNG::Decoder decoder(data, len);
+			width = PNG::Decoder::scaled(decoder.get_width(), scale), height = PNG::Decoder::scaled(decoder.get_height(), scale), has_alpha = decoder.get_has_alpha();
+			error = png_output(L, width, height, has_alpha, x, y, premultiply, has_image ? &image : nullptr, texture, packed,
+				[&decoder,scale](const Image::View& target, const int x, const int y, const bool premultiply, const bool bgr){
+					decoder.decode(target, x, y, scale, premultiply, bgr);
+				});
+		}
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(error)
+		return luaL_error(L, error);
+	// Send dimensions or new image table
+	if(has_image || texture){
+		lua_pushinteger(L, width);
+		lua_pushinteger(L, height);
+		return 2;
+	}
 	lua_createtable(L, 0, 4);
 	lua_pushinteger(L, width); lua_setfield(L, -2, "width");
 	lua_pushinteger(L, height); lua_setfield(L, -2, "height");
-	lua_pushstring(L, color_type & PNG_COLOR_MASK_ALPHA ? "rgba" : "rgb"); lua_setfield(L, -2, "type");
-	lua_pushlstring(L, data.data(), data.length()); lua_setfield(L, -2, "data");
+	lua_pushstring(L, has_alpha ? "rgba" : "rgb"); lua_setfield(L, -2, "type");
+	lua_pushlstring(L, packed.data(), packed.length()); lua_setfield(L, -2, "data");
 	return 1;
 }
 
@@ -76,8 +139,9 @@ static int png_encode(std::ostream& out, lua_State* L) noexcept{
 	lua_getfield(L, 1, "type");
 	lua_getfield(L, 1, "data");
 	const int width = luaL_checkinteger(L, -4), height = luaL_checkinteger(L, -3);
-	const std::string type(luaL_checkstring(L, -2)),
-			data(luaL_checkstring(L, -1), lua_rawlen(L, -1));
+	const std::string type(luaL_checkstring(L, -2));
+	size_t data_len;
+	const char* data = luaL_checklstring(L, -1, &data_len);	// Stays referenced by table
 	lua_pop(L, 4);
 	// Check arguments
 	if(width < 0 || height < 0)
@@ -85,46 +149,178 @@ static int png_encode(std::ostream& out, lua_State* L) noexcept{
 	if(type != "rgb" && type != "rgba")
 		return luaL_error(L, "Invalid type!");
 	const bool has_alpha = type == "rgba";
-	if(data.length() != static_cast<size_t>(width * height * (has_alpha ? 4 : 3)))
+	if(data_len != static_cast<size_t>(width * height * (has_alpha ? 4 : 3)))
 		return luaL_error(L, "Invalid data size!");
-	// Create PNG structures
-	png_infop png_info = nullptr;
-	const std::unique_ptr<png_struct,std::function<void(png_structp)>> png(png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr), [&png_info](png_structp png){png_destroy_write_struct(&png, &png_info);});
-	if(!png || !(png_info = png_create_info_struct(png.get())))
-		return luaL_error(L, "Couldn't create PNG structures!");
-	// Set PNG error "handler"
-	if(setjmp(png_jmpbuf(png.get())))
-		return luaL_error(L, "PNG write error occured!");
-	// Set PNG target writer
-	png_set_write_fn(png.get(), &out, [](png_structp png, png_bytep in, png_size_t in_size){
-		if(!static_cast<std::ostream*>(png_get_io_ptr(png))->write(reinterpret_cast<char*>(in), in_size))
-			longjmp(png_jmpbuf(png), 1);
-	}, nullptr);
-	// Write PNG header informations
-	png_set_IHDR(png.get(), png_info, width, height, 8, has_alpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-	png_write_info(png.get(), png_info);
-	// Write PNG image
-	png_bytep pdata = reinterpret_cast<png_bytep>(const_cast<char*>(data.data()));
-	const png_size_t rowbytes = png_get_rowbytes(png.get(), png_info);
-	assert(rowbytes == static_cast<png_size_t>(width * (has_alpha ? 4 : 3)));
-	for(const png_bytep data_end = pdata + height * rowbytes; pdata != data_end; pdata += rowbytes)
-		png_write_row(png.get(), pdata);
-	png_write_end(png.get(), png_info);
+	// Encode packed rows
+	try{
+		PNG::encode({reinterpret_cast<unsigned char*>(const_cast<char*>(data)), static_cast<unsigned>(width), static_cast<unsigned>(height), static_cast<ptrdiff_t>(width * (has_alpha ? 4 : 3)), has_alpha, false}, out, -1, PNG_ALL_FILTERS, false);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
 	// No errors occured
 	return 0;
 }
 
+// Sequence metatable methods
+static PNG::Sequence* luaL_checksequence(lua_State* L, int arg) noexcept{
+	return *static_cast<PNG::Sequence**>(luaL_checkudata(L, arg, LUA_PNG_SEQUENCE));
+}
+
+static int sequence_free(lua_State* L) noexcept{
+	delete luaL_checksequence(L, 1);
+	return 0;
+}
+
+static int sequence_len(lua_State* L) noexcept{
+	const PNG::Sequence* seq = luaL_checksequence(L, 1);
+	lua_pushinteger(L, seq->get_last() - seq->get_first() + 1);
+	return 1;
+}
+
+static int sequence_range(lua_State* L) noexcept{
+	const PNG::Sequence* seq = luaL_checksequence(L, 1);
+	lua_pushinteger(L, seq->get_first());
+	lua_pushinteger(L, seq->get_last());
+	return 2;
+}
+
+static int sequence_filename(lua_State* L) noexcept{
+	const PNG::Sequence* seq = luaL_checksequence(L, 1);
+	lua_pushstring(L, seq->filename(luaL_checkinteger(L, 2)).c_str());
+	return 1;
+}
+
+static int sequence_ready(lua_State* L) noexcept{
+	lua_pushboolean(L, luaL_checksequence(L, 1)->ready(luaL_checkinteger(L, 2)));
+	return 1;
+}
+
+static int sequence_get(lua_State* L) noexcept{
+	// Get arguments
+	PNG::Sequence* seq = luaL_checksequence(L, 1);
+	const int i = luaL_checkinteger(L, 2);
+	Image::View target;
+	const bool has_target = !lua_isnoneornil(L, 3);
+	luaL_argcheck(L, !has_target || lua_toimage(L, 3, target), 3, "canvas or frame expected");
+	const int x = luaL_optinteger(L, 4, 0), y = luaL_optinteger(L, 5, 0);
+	// Copy decoded frame into target or new canvas
+	try{
+		const std::shared_ptr<Image::Canvas> frame = seq->get(i);
+		const Image::View src = frame->view();
+		if(has_target){
+			const Image::View dst = target.sub(x, y, src.width, src.height);
+			Image::copy(src.sub(std::max(0, -x), std::max(0, -y), dst.width, dst.height), dst);
+			lua_pushinteger(L, src.width);
+			lua_pushinteger(L, src.height);
+			return 2;
+		}
+		Image::Canvas* canvas = new Image::Canvas(src.width, src.height);
+		Image::copy(src, canvas->view());
+		lua_pushcanvas(L, canvas);
+		return 1;
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+}
+
+// Writer metatable methods
+static PNG::Writer* luaL_checkwriter(lua_State* L, int arg) noexcept{
+	return *static_cast<PNG::Writer**>(luaL_checkudata(L, arg, LUA_PNG_WRITER));
+}
+
+static int writer_free(lua_State* L) noexcept{
+	delete luaL_checkwriter(L, 1);
+	return 0;
+}
+
+static int writer_write(lua_State* L) noexcept{
+	// Get arguments
+	PNG::Writer* writer = luaL_checkwriter(L, 1);
+	const char* name = luaL_optstring(L, 3, "");
+	Image::View image;
+	bool bgr = true;
+	if(!lua_toimage(L, 2, image)){
+		// Image table like for png.write
+		luaL_argcheck(L, lua_istable(L, 2), 2, "canvas, frame or image table expected");
+		lua_getfield(L, 2, "width");
+		lua_getfield(L, 2, "height");
+		lua_getfield(L, 2, "type");
+		lua_getfield(L, 2, "data");
+		const int width = luaL_checkinteger(L, -4), height = luaL_checkinteger(L, -3);
+		const std::string type(luaL_checkstring(L, -2));
+		size_t data_len;
+		const char* data = luaL_checklstring(L, -1, &data_len);
+		if(width < 0 || height < 0)
+			return luaL_error(L, "Invalid dimension!");
+		if(type != "rgb" && type != "rgba")
+			return luaL_error(L, "Invalid type!");
+		const bool has_alpha = type == "rgba";
+		if(data_len != static_cast<size_t>(width * height * (has_alpha ? 4 : 3)))
+			return luaL_error(L, "Invalid data size!");
+		image = {reinterpret_cast<unsigned char*>(const_cast<char*>(data)), static_cast<unsigned>(width), static_cast<unsigned>(height), static_cast<ptrdiff_t>(width * (has_alpha ? 4 : 3)), has_alpha, false};
+		bgr = false;
+	}
+	// Queue image
+	try{
+		lua_pushstring(L, writer->write(image, name, bgr).c_str());
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int writer_pending(lua_State* L) noexcept{
+	lua_pushinteger(L, luaL_checkwriter(L, 1)->get_pending());
+	return 1;
+}
+
+static int writer_flush(lua_State* L) noexcept{
+	try{
+		luaL_checkwriter(L, 1)->flush();
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 0;
+}
+
 // General functions
 static int png_read(lua_State* L) noexcept{
-	std::istringstream in(std::string(luaL_checkstring(L, 1), lua_rawlen(L, 1)));
-	return png_decode(in, L);
+	// Read from string or mapped file memory without copy
+	size_t len = 0;
+	const char* data = lua_tobytes(L, 1, &len);
+	luaL_argcheck(L, data, 1, "string or mapped file expected");
+	return png_decode(L, nullptr, reinterpret_cast<const unsigned char*>(data), len, 2);
 }
 
 static int png_read_file(lua_State* L) noexcept{
-	std::ifstream in(luaL_checkstring(L, 1), std::ios_base::binary);
-	if(!in)
-		return luaL_error(L, "Couldn't open input file!");
-	return png_decode(in, L);
+	return png_decode(L, luaL_checkstring(L, 1), nullptr, 0, 2);
+}
+
+static int png_cache(lua_State* L) noexcept{
+	// Set memory budget
+	if(!lua_isnoneornil(L, 1)){
+		const lua_Integer budget = luaL_checkinteger(L, 1);
+		luaL_argcheck(L, budget >= 0, 1, "negative budget");
+		PNG::cache().set_budget(budget);
+	}
+	// Get statistics
+	const PNG::Cache::Stats stats = PNG::cache().get_stats();
+	lua_createtable(L, 0, 7);
+	lua_pushinteger(L, stats.hits); lua_setfield(L, -2, "hits");
+	lua_pushinteger(L, stats.misses); lua_setfield(L, -2, "misses");
+	lua_pushnumber(L, stats.hits + stats.misses ? static_cast<double>(stats.hits) / (stats.hits + stats.misses) : 0); lua_setfield(L, -2, "hit_rate");
+	lua_pushinteger(L, stats.evictions); lua_setfield(L, -2, "evictions");
+	lua_pushinteger(L, stats.entries); lua_setfield(L, -2, "entries");
+	lua_pushinteger(L, stats.bytes); lua_setfield(L, -2, "bytes");
+	lua_pushinteger(L, stats.budget); lua_setfield(L, -2, "budget");
+	return 1;
+}
+
+static int png_cache_clear(lua_State*) noexcept{
+	PNG::cache().clear();
+	return 0;
 }
 
 static int png_write(lua_State* L) noexcept{
@@ -144,6 +340,94 @@ static int png_write_file(lua_State* L) noexcept{
 	return 0;
 }
 
+static int png_sequence(lua_State* L) noexcept{
+	// Get arguments
+	const char* pattern = luaL_checkstring(L, 1);
+	luaL_argcheck(L, lua_isnoneornil(L, 2) || lua_istable(L, 2), 2, "optional table expected");
+	int first = 0, last = -1, ahead = 4, behind = 1, cache = 8, scale = 1;
+	if(lua_istable(L, 2)){
+		lua_getfield(L, 2, "first"); first = luaL_optinteger(L, -1, first);
+		lua_getfield(L, 2, "last"); last = luaL_optinteger(L, -1, first - 1);
+		lua_getfield(L, 2, "ahead"); ahead = luaL_optinteger(L, -1, ahead);
+		lua_getfield(L, 2, "behind"); behind = luaL_optinteger(L, -1, behind);
+		lua_getfield(L, 2, "cache"); cache = luaL_optinteger(L, -1, cache);
+		lua_getfield(L, 2, "scale"); scale = luaL_optinteger(L, -1, scale);
+		lua_pop(L, 6);
+	}
+	if(ahead < 0 || behind < 0 || cache < 1)
+		return luaL_error(L, "Invalid prefetch or cache size!");
+	if(scale < 1 || scale > 16)
+		return luaL_error(L, "Invalid scale!");
+	// Create sequence userdata
+	try{
+		*static_cast<PNG::Sequence**>(lua_newuserdata(L, sizeof(PNG::Sequence*))) = new PNG::Sequence(pattern, first, last, ahead, behind, cache, scale);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(luaL_newmetatable(L, LUA_PNG_SEQUENCE)){
+		static const luaL_Reg meta[] = {
+			{"__gc", sequence_free},
+			{"__len", sequence_len},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"range", sequence_range},
+			{"filename", sequence_filename},
+			{"ready", sequence_ready},
+			{"get", sequence_get},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int png_writer(lua_State* L) noexcept{
+	// Get arguments
+	const char* dir = luaL_checkstring(L, 1);
+	luaL_argcheck(L, lua_isnoneornil(L, 2) || lua_istable(L, 2), 2, "optional table expected");
+	std::string pattern = "%06d.png";
+	int first = 0, level = -1, filters = PNG_ALL_FILTERS, queue = 8;
+	if(lua_istable(L, 2)){
+		static const char* filter_str[] = {"all", "fast", "none", "sub", "up", "avg", "paeth", nullptr};
+		static const int filter_enum[] = {PNG_ALL_FILTERS, PNG_FILTER_NONE | PNG_FILTER_SUB | PNG_FILTER_UP, PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH};
+		lua_getfield(L, 2, "pattern"); pattern = luaL_optstring(L, -1, pattern.c_str());
+		lua_getfield(L, 2, "first"); first = luaL_optinteger(L, -1, first);
+		lua_getfield(L, 2, "level"); level = luaL_optinteger(L, -1, level);
+		lua_getfield(L, 2, "filter"); filters = filter_enum[luaL_checkoption(L, -1, "all", filter_str)];
+		lua_getfield(L, 2, "queue"); queue = luaL_optinteger(L, -1, queue);
+		lua_pop(L, 5);
+	}
+	if(level < -1 || level > 9)
+		return luaL_error(L, "Invalid compression level!");
+	if(queue < 1)
+		return luaL_error(L, "Invalid queue size!");
+	// Create writer userdata
+	try{
+		*static_cast<PNG::Writer**>(lua_newuserdata(L, sizeof(PNG::Writer*))) = new PNG::Writer(dir, pattern, first, level, filters, queue);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(luaL_newmetatable(L, LUA_PNG_WRITER)){
+		static const luaL_Reg meta[] = {
+			{"__gc", writer_free},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"write", writer_write},
+			{"pending", writer_pending},
+			{"flush", writer_flush},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
 static int png_version(lua_State* L) noexcept{
 	lua_pushstring(L, PNG_HEADER_VERSION_STRING);
 	return 1;
@@ -155,6 +439,10 @@ int luaopen_png(lua_State* L)/* No exception specifier because of C declaration
 		{"readfile", png_read_file},
 		{"write", png_write},
 		{"writefile", png_write_file},
+		{"sequence", png_sequence},
+		{"writer", png_writer},
+		{"cache", png_cache},
+		{"clearcache", png_cache_clear},
 		{"version", png_version},
 		{NULL, NULL}
 	};
@@ -15,15 +15,125 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "libs.h"
 #include "../utils/lua.h"
 #include <boost/regex.hpp>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <climits>
 
-// Unique name for Lua metatable
+// Unique names for Lua metatables
 #define LUA_REGEX "regex"
+#define LUA_REGEX_ITERATOR "regex_iterator"
 
-// Userdata container
+// Maximal number of compiled expressions kept for reuse
+#define REGEX_CACHE_SIZE 64
+
+// Userdata containers
 struct RegexArgs{
-	const boost::regex expr;
+	const std::shared_ptr<const boost::regex> expr;
 	const boost::regex_constants::match_flag_type flag;
 };
+struct RegexIterator{
+	const std::shared_ptr<const boost::regex> expr;	// Keeps expression alive independent of regex userdata
+	boost::cregex_iterator it;
+};
+
+// Cache of compiled expressions (least recently used get dropped)
+class RegexCache{
+	private:
+		typedef std::pair<std::string, boost::regex_constants::syntax_option_type> Key;
+		struct KeyHash{
+			size_t operator()(const Key& key) const noexcept{
+				return std::hash<std::string>()(key.first) ^ std::hash<unsigned>()(key.second);
+			}
+		};
+		typedef std::list<std::pair<Key, std::shared_ptr<const boost::regex>>> Entries;
+		Entries entries;
+		std::unordered_map<Key, Entries::iterator, KeyHash> index;
+		std::mutex mutex;
+	public:
+		std::shared_ptr<const boost::regex> get(const std::string& expr, const boost::regex_constants::syntax_option_type syntax){
+			const Key key(expr, syntax);
+			std::lock_guard<std::mutex> lock(this->mutex);
+			// Cache hit
+			auto it = this->index.find(key);
+			if(it != this->index.end()){
+				this->entries.splice(this->entries.begin(), this->entries, it->second);
+				return it->second->second;
+			}
+			// Cache miss
+			std::shared_ptr<const boost::regex> reg = std::make_shared<const boost::regex>(expr, syntax);
+			this->entries.emplace_front(key, reg);
+			this->index[key] = this->entries.begin();
+			if(this->entries.size() > REGEX_CACHE_SIZE){
+				this->index.erase(this->entries.back().first);
+				this->entries.pop_back();
+			}
+			return reg;
+		}
+};
+static RegexCache regex_cache;
+
+// Helpers
+static void lua_pushmatch(lua_State* L, const boost::cmatch& matches, const char* str, const bool positions_only) noexcept{
+	if(positions_only){
+		lua_createtable(L, matches.size() << 1, 0);
+		for(size_t sub_i = 0; sub_i < matches.size(); ++sub_i)
+			if(matches[sub_i].matched){
+				lua_pushinteger(L, 1+(matches[sub_i].first-str)); lua_rawseti(L, -2, (sub_i<<1)+1);
+				lua_pushinteger(L, matches[sub_i].second-str); lua_rawseti(L, -2, (sub_i<<1)+2);
+			}
+	}else{
+		lua_createtable(L, matches.size(), 0);
+		for(size_t sub_i = 1; sub_i <= matches.size(); ++sub_i){
+			lua_createtable(L, 0, 2);
+			lua_pushinteger(L, 1+matches.position(sub_i-1)); lua_setfield(L, -2, "position");
+			lua_pushlstring(L, matches[sub_i-1].first, matches.length(sub_i-1)); lua_setfield(L, -2, "string");
+			lua_rawseti(L, -2, sub_i);
+		}
+	}
+}
+
+static void lua_pushmatches(lua_State* L, const RegexArgs* args, const char* str, const size_t len, const bool positions_only){
+	lua_newtable(L);
+	int i = 0;
+	for(boost::cregex_iterator it(str, str+len, *args->expr, args->flag), it_end; it != it_end; ++it){
+		lua_pushmatch(L, *it, str, positions_only);
+		lua_rawseti(L, -2, ++i);
+	}
+}
+
+// Regex iterator metatable methods
+static int regex_iterator_free(lua_State* L) noexcept{
+	delete *static_cast<RegexIterator**>(luaL_checkudata(L, 1, LUA_REGEX_ITERATOR));
+	return 0;
+}
+
+static int regex_iterator_next(lua_State* L) noexcept{
+	RegexIterator* state = *static_cast<RegexIterator**>(lua_touserdata(L, lua_upvalueindex(1)));
+	const char* str = lua_tostring(L, lua_upvalueindex(2));
+	if(state->it == boost::cregex_iterator())
+		return 0;
+	// Push positions of match and sub-matches (no match -> nil)
+	const boost::cmatch& matches = *state->it;
+	if(matches.size() > static_cast<size_t>(INT_MAX >> 1) || !lua_checkstack(L, static_cast<int>(matches.size() << 1)))
+		return luaL_error(L, "Too many sub-matches!");
+	const int n = static_cast<int>(matches.size() << 1);	// Matches get freed by increment after last one
+	for(size_t sub_i = 0; sub_i < matches.size(); ++sub_i)
+		if(matches[sub_i].matched){
+			lua_pushinteger(L, 1+(matches[sub_i].first-str));
+			lua_pushinteger(L, matches[sub_i].second-str);
+		}else{
+			lua_pushnil(L);
+			lua_pushnil(L);
+		}
+	try{
+		++state->it;
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return n;
+}
 
 // Regex metatable methods
 static int regex_free(lua_State* L) noexcept{
@@ -33,9 +143,15 @@ static int regex_free(lua_State* L) noexcept{
 
 static int regex_replace(lua_State* L) noexcept{
 	const RegexArgs* args = *static_cast<RegexArgs**>(luaL_checkudata(L, 1, LUA_REGEX));
+	size_t len;
+	const char* str = luaL_checklstring(L, 2, &len),
+		*format = luaL_checkstring(L, 3);
 	try{
-		lua_pushstring(L, boost::regex_replace(std::string(luaL_checkstring(L, 2)), args->expr, std::string(luaL_checkstring(L, 3)), args->flag).c_str());
-	}catch(const boost::regex_error& e){
+		std::string result;
+		result.reserve(len);
+		boost::regex_replace(std::back_inserter(result), str, str+len, *args->expr, format, args->flag);
+		lua_pushlstring(L, result.data(), result.size());
+	}catch(const std::exception& e){
 		return luaL_error(L, e.what());
 	}
 	return 1;
@@ -43,20 +159,57 @@ static int regex_replace(lua_State* L) noexcept{
 
 static int regex_match(lua_State* L) noexcept{
 	const RegexArgs* args = *static_cast<RegexArgs**>(luaL_checkudata(L, 1, LUA_REGEX));
-	const std::string str = luaL_checkstring(L, 2);
-	boost::sregex_iterator it(str.cbegin(), str.cend(), args->expr, args->flag), it_end;
-	lua_createtable(L, std::distance(it, it_end), 0);
-	for(int i = 1; it != it_end; ++it, ++i){
-		const boost::smatch& matches = *it;
-		lua_createtable(L, matches.size(), 0);
-		for(size_t sub_i = 1; sub_i <= matches.size(); ++sub_i){
-			lua_createtable(L, 0, 2);
-			lua_pushinteger(L, 1+matches.position(sub_i-1)); lua_setfield(L, -2, "position");
-			lua_pushstring(L, matches.str(sub_i-1).c_str()); lua_setfield(L, -2, "string");
-			lua_rawseti(L, -2, sub_i);
+	size_t len;
+	const char* str = luaL_checklstring(L, 2, &len);
+	const bool positions_only = luaL_optboolean(L, 3, false);
+	try{
+		lua_pushmatches(L, args, str, len, positions_only);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int regex_matchn(lua_State* L) noexcept{
+	const RegexArgs* args = *static_cast<RegexArgs**>(luaL_checkudata(L, 1, LUA_REGEX));
+	luaL_checktype(L, 2, LUA_TTABLE);
+	const bool positions_only = luaL_optboolean(L, 3, false);
+	const size_t n = lua_rawlen(L, 2);
+	lua_createtable(L, n, 0);
+	try{
+		for(size_t i = 1; i <= n; ++i){
+			lua_rawgeti(L, 2, i);
+			size_t len;
+			const char* str = lua_tolstring(L, -1, &len);
+			if(!str)
+				return luaL_error(L, "Table must contain strings only!");
+			lua_pushmatches(L, args, str, len, positions_only);
+			lua_rawseti(L, -3, i);
+			lua_pop(L, 1);
 		}
-		lua_rawseti(L, -2, i);
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
+static int regex_gmatch(lua_State* L) noexcept{
+	const RegexArgs* args = *static_cast<RegexArgs**>(luaL_checkudata(L, 1, LUA_REGEX));
+	size_t len;
+	const char* str = luaL_checklstring(L, 2, &len);
+	lua_settop(L, 2);
+	// Create iterator state (upvalue #1) referring to subject string (upvalue #2)
+	try{
+		*static_cast<RegexIterator**>(lua_newuserdata(L, sizeof(RegexIterator*))) = new RegexIterator{args->expr, boost::cregex_iterator(str, str+len, *args->expr, args->flag)};
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	if(luaL_newmetatable(L, LUA_REGEX_ITERATOR)){
+		lua_pushcfunction(L, regex_iterator_free); lua_setfield(L, -2, "__gc");
 	}
+	lua_setmetatable(L, -2);
+	lua_insert(L, 2);
+	lua_pushcclosure(L, regex_iterator_next, 2);
 	return 1;
 }
 
@@ -87,9 +240,9 @@ static int regex_create(lua_State* L) noexcept{
 		}
 		lua_pop(L, n);
 	}
-	// Create regex userdata
+	// Create regex userdata (with compiled expression from cache)
 	try{
-		boost::regex reg(expr, syntax);
+		std::shared_ptr<const boost::regex> reg = regex_cache.get(expr, syntax);
 		*static_cast<RegexArgs**>(lua_newuserdata(L, sizeof(RegexArgs*))) = new RegexArgs{std::move(reg), flag};
 	}catch(const boost::regex_error& e){
 		return luaL_error(L, e.what());
@@ -99,6 +252,8 @@ static int regex_create(lua_State* L) noexcept{
 			{"__gc", regex_free},
 			{"replace", regex_replace},
 			{"match", regex_match},
+			{"matchn", regex_matchn},
+			{"gmatch", regex_gmatch},
 			{NULL, NULL}
 		};
 		luaL_setfuncs(L, l, 0);
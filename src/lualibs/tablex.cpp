@@ -16,6 +16,13 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "../utils/lua.h"
 #include <functional>
 #include <sstream>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 static int table_copy(lua_State* L) noexcept{
 	// Check main argument
@@ -139,6 +146,296 @@ static int table_tostring(lua_State* L) noexcept{
 	return 1;
 }
 
+// Binary serialization format (native byte order, for caching purposes)
+#define TABLE_SERIAL_SIGNATURE "FLTB\x01"
+#ifndef TABLE_SERIAL_MAX_DEPTH
+	#define TABLE_SERIAL_MAX_DEPTH 200	// Nested tables (recursion on C stack)
+#endif
+namespace TableSerial{
+	enum Tag : unsigned char{NIL = 0, FALSE, TRUE, INTEGER, NUMBER, STRING, STRING_REF, TABLE, TABLE_REF};
+	// Unsigned variable-length integers (7 bits per byte)
+	inline void write_varint(std::string& buf, uint64_t x){
+		while(x > 0x7f){
+			buf += static_cast<char>((x & 0x7f) | 0x80);
+			x >>= 7;
+		}
+		buf += static_cast<char>(x);
+	}
+	inline uint64_t read_varint(const unsigned char*& p, const unsigned char* end){
+		uint64_t x = 0;
+		for(unsigned shift = 0; shift < 64; shift += 7){
+			if(p == end)
+				throw std::out_of_range("Unexpected end of data!");
+			const unsigned char byte = *p++;
+			x |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if(!(byte & 0x80))
+				return x;
+		}
+		throw std::out_of_range("Invalid integer encoding!");
+	}
+	// Signed integers in zigzag encoding (small absolute values stay short)
+	inline void write_int(std::string& buf, const int64_t x){
+		write_varint(buf, (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63));
+	}
+	inline int64_t read_int(const unsigned char*& p, const unsigned char* end){
+		const uint64_t x = read_varint(p, end);
+		return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1);
+	}
+	// Checks value types & nesting and registers tables/strings by first occurrence (value -> id), raises Lua errors
+	inline void check_value(lua_State* L, int index, const unsigned depth, const int refs_index, lua_Number& refs_n) noexcept{
+		if(index < 0)
+			index = lua_gettop(L) + index + 1;
+		switch(lua_type(L, index)){
+			case LUA_TNIL:
+			case LUA_TBOOLEAN:
+			case LUA_TNUMBER:
+				break;
+			case LUA_TSTRING:
+			case LUA_TTABLE:{
+				// Already registered?
+				lua_pushvalue(L, index);
+				lua_rawget(L, refs_index);
+				const bool registered = !lua_isnil(L, -1);
+				lua_pop(L, 1);
+				if(registered)
+					break;
+				// Register value (before content for cyclic tables)
+				lua_pushvalue(L, index);
+				lua_pushnumber(L, refs_n++);
+				lua_rawset(L, refs_index);
+				if(lua_type(L, index) == LUA_TSTRING)
+					break;
+				// Check table content in write order: array part, then hash part
+				if(depth >= TABLE_SERIAL_MAX_DEPTH || !lua_checkstack(L, 4))
+					luaL_error(L, "Table nesting too deep!");
+				const size_t n = lua_rawlen(L, index);
+				for(size_t i = 1; i <= n; ++i){
+					lua_rawgeti(L, index, i);
+					check_value(L, -1, depth+1, refs_index, refs_n);
+					lua_pop(L, 1);
+				}
+				lua_pushnil(L);
+				while(lua_next(L, index)){
+					if(lua_type(L, -2) == LUA_TNUMBER){
+						const lua_Number key = lua_tonumber(L, -2);
+						if(key >= 1 && key <= n && key == std::floor(key)){
+							lua_pop(L, 1);
+							continue;
+						}
+					}
+					check_value(L, -2, depth+1, refs_index, refs_n);
+					check_value(L, -1, depth+1, refs_index, refs_n);
+					lua_pop(L, 1);
+				}
+			}break;
+			default:
+				luaL_error(L, "Unsupported value type: %s", luaL_typename(L, index));
+		}
+	}
+	// Writes value checked by check_value (raises no Lua errors), ids below written_n are references
+	inline void write_value(lua_State* L, std::string& buf, int index, const int refs_index, uint64_t& written_n){
+		if(index < 0)
+			index = lua_gettop(L) + index + 1;
+		switch(lua_type(L, index)){
+			case LUA_TNIL:
+				buf += static_cast<char>(NIL);
+				break;
+			case LUA_TBOOLEAN:
+				buf += static_cast<char>(lua_toboolean(L, index) ? TRUE : FALSE);
+				break;
+			case LUA_TNUMBER:{
+#if LUA_VERSION_NUM >= 503
+				if(lua_isinteger(L, index)){
+					buf += static_cast<char>(INTEGER);
+					write_int(buf, lua_tointeger(L, index));
+					break;
+				}
+#else
+				const lua_Number x = lua_tonumber(L, index);
+				if(x == std::floor(x) && std::fabs(x) < 9007199254740992.0 /* 2^53 */){
+					buf += static_cast<char>(INTEGER);
+					write_int(buf, static_cast<int64_t>(x));
+					break;
+				}
+#endif
+				const double d = lua_tonumber(L, index);
+				buf += static_cast<char>(NUMBER);
+				buf.append(reinterpret_cast<const char*>(&d), sizeof(d));
+			}break;
+			case LUA_TSTRING:
+			case LUA_TTABLE:{
+				// Reference to already written value?
+				lua_pushvalue(L, index);
+				lua_rawget(L, refs_index);
+				const uint64_t id = static_cast<uint64_t>(lua_tonumber(L, -1));
+				lua_pop(L, 1);
+				if(id < written_n){
+					buf += static_cast<char>(lua_type(L, index) == LUA_TSTRING ? STRING_REF : TABLE_REF);
+					write_varint(buf, id);
+					break;
+				}
+				++written_n;
+				// Write string
+				if(lua_type(L, index) == LUA_TSTRING){
+					size_t len;
+					const char* str = lua_tolstring(L, index, &len);
+					buf += static_cast<char>(STRING);
+					write_varint(buf, len);
+					buf.append(str, len);
+					break;
+				}
+				// Write table: array part, then hash part with backpatched count
+				const size_t n = lua_rawlen(L, index);
+				buf += static_cast<char>(TABLE);
+				write_varint(buf, n);
+				for(size_t i = 1; i <= n; ++i){
+					lua_rawgeti(L, index, i);
+					write_value(L, buf, -1, refs_index, written_n);
+					lua_pop(L, 1);
+				}
+				const size_t hash_n_pos = buf.size();
+				uint32_t hash_n = 0;
+				buf.append(sizeof(hash_n), '\0');
+				lua_pushnil(L);
+				while(lua_next(L, index)){
+					if(lua_type(L, -2) == LUA_TNUMBER){
+						const lua_Number key = lua_tonumber(L, -2);
+						if(key >= 1 && key <= n && key == std::floor(key)){
+							lua_pop(L, 1);
+							continue;
+						}
+					}
+					write_value(L, buf, -2, refs_index, written_n);
+					write_value(L, buf, -1, refs_index, written_n);
+					++hash_n;
+					lua_pop(L, 1);
+				}
+				std::memcpy(&buf[hash_n_pos], &hash_n, sizeof(hash_n));
+			}break;
+		}
+	}
+}
+
+static int table_serialize(lua_State* L) noexcept{
+	using namespace TableSerial;
+	// Check argument
+	luaL_checktype(L, 1, LUA_TTABLE);
+	// Remove unnecessary arguments
+	lua_settop(L, 1);
+	// Index of tables & strings (value -> id), filled while checking all values before any C++ object exists
+	lua_newtable(L);
+	const int refs_index = lua_gettop(L);
+	lua_Number refs_n = 0;
+	check_value(L, 1, 0, refs_index, refs_n);
+	// Write values into buffer & return it as string to Lua
+	bool out_of_memory = false;
+	try{
+		std::string buf(TABLE_SERIAL_SIGNATURE);
+		uint64_t written_n = 0;
+		write_value(L, buf, 1, refs_index, written_n);
+		lua_pushlstring(L, buf.data(), buf.size());
+	}catch(const std::bad_alloc&){
+		out_of_memory = true;
+	}
+	if(out_of_memory)
+		return luaL_error(L, "Not enough memory!");
+	return 1;
+}
+
+static int table_deserialize(lua_State* L) noexcept{
+	using namespace TableSerial;
+	// Get argument
+	size_t len = 0;
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(lua_tobytes(L, 1, &len));
+	luaL_argcheck(L, data, 1, "string or mapped file expected");
+	const unsigned char* const end = data + len;
+	luaL_argcheck(L, len >= sizeof(TABLE_SERIAL_SIGNATURE)-1 && std::memcmp(data, TABLE_SERIAL_SIGNATURE, sizeof(TABLE_SERIAL_SIGNATURE)-1) == 0, 1, "no serialized table");
+	data += sizeof(TABLE_SERIAL_SIGNATURE)-1;
+	// Index of already read tables & strings (id -> value)
+	lua_settop(L, 1);
+	lua_newtable(L);
+	const int refs_index = lua_gettop(L);
+	int refs_n = 0;
+	// Read values recursive
+	std::function<void(const unsigned)> read;
+	read = [&read,L,&data,end,refs_index,&refs_n](const unsigned depth){
+		if(data == end)
+			throw std::out_of_range("Unexpected end of data!");
+		if(depth > TABLE_SERIAL_MAX_DEPTH || !lua_checkstack(L, 4))
+			throw std::length_error("Table nesting too deep!");
+		switch(*data++){
+			case NIL: lua_pushnil(L); break;
+			case FALSE: lua_pushboolean(L, false); break;
+			case TRUE: lua_pushboolean(L, true); break;
+			case INTEGER:
+#if LUA_VERSION_NUM >= 503
+				lua_pushinteger(L, read_int(data, end));
+#else
+				lua_pushnumber(L, read_int(data, end));
+#endif
+				break;
+			case NUMBER:{
+				double d;
+				if(static_cast<size_t>(end - data) < sizeof(d))
+					throw std::out_of_range("Unexpected end of data!");
+				std::memcpy(&d, data, sizeof(d));
+				data += sizeof(d);
+				lua_pushnumber(L, d);
+			}break;
+			case STRING:{
+				const uint64_t str_len = read_varint(data, end);
+				if(static_cast<uint64_t>(end - data) < str_len)
+					throw std::out_of_range("Unexpected end of data!");
+				lua_pushlstring(L, reinterpret_cast<const char*>(data), str_len);
+				data += str_len;
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, refs_index, ++refs_n);
+			}break;
+			case STRING_REF:
+			case TABLE_REF:{
+				const uint64_t id = read_varint(data, end);
+				if(id >= static_cast<uint64_t>(refs_n))
+					throw std::out_of_range("Invalid reference!");
+				lua_rawgeti(L, refs_index, id+1);
+			}break;
+			case TABLE:{
+				const uint64_t n = read_varint(data, end);
+				uint32_t hash_n;
+				if(n > static_cast<uint64_t>(end - data))	// Every value needs one byte at least
+					throw std::out_of_range("Unexpected end of data!");
+				lua_createtable(L, n, 0);
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, refs_index, ++refs_n);
+				for(uint64_t i = 1; i <= n; ++i){
+					read(depth+1);
+					lua_rawseti(L, -2, i);
+				}
+				if(static_cast<size_t>(end - data) < sizeof(hash_n))
+					throw std::out_of_range("Unexpected end of data!");
+				std::memcpy(&hash_n, data, sizeof(hash_n));
+				data += sizeof(hash_n);
+				for(uint32_t i = 0; i < hash_n; ++i){
+					read(depth+1);
+					if(lua_isnil(L, -1) || (lua_type(L, -1) == LUA_TNUMBER && lua_tonumber(L, -1) != lua_tonumber(L, -1)))
+						throw std::invalid_argument("Invalid table key!");
+					read(depth+1);
+					lua_rawset(L, -3);
+				}
+			}break;
+			default:
+				throw std::invalid_argument("Invalid value tag!");
+		}
+	};
+	try{
+		read(0);
+		if(data != end)
+			throw std::invalid_argument("Trailing data!");
+	}catch(const std::exception& e){
+		return luaL_error(L, e.what());
+	}
+	return 1;
+}
+
 static int table_allocate(lua_State* L) noexcept{
 	lua_createtable(L, luaL_checkinteger(L, 1), luaL_checkinteger(L, 2));
 	return 1;
@@ -359,10 +656,146 @@ static int table_move(lua_State* L) noexcept{
 	return 0;
 }
 
+// Sort keys helpers
+namespace TableSort{
+	// Order-preserving mapping of doubles to unsigned integers
+	inline uint64_t number_bits(double x) noexcept{
+		if(x == 0)
+			x = 0;	// Negative zero equals zero
+		uint64_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		return bits & 0x8000000000000000ull ? ~bits : bits | 0x8000000000000000ull;
+	}
+	// LSD radix sort (stable) of key+index pairs, 8 bits per pass
+	inline void radix_sort(std::vector<std::pair<uint64_t,size_t>>& items){
+		std::vector<std::pair<uint64_t,size_t>> tmp(items.size());
+		for(unsigned shift = 0; shift < 64; shift += 8){
+			size_t offsets[256] = {};
+			for(const auto& item : items)
+				++offsets[(item.first >> shift) & 0xff];
+			// Skip passes with all keys in one bucket
+			if(offsets[(items.front().first >> shift) & 0xff] == items.size())
+				continue;
+			for(size_t i = 0, sum = 0; i < 256; ++i){
+				const size_t count = offsets[i];
+				offsets[i] = sum;
+				sum += count;
+			}
+			for(const auto& item : items)
+				tmp[offsets[(item.first >> shift) & 0xff]++] = item;
+			items.swap(tmp);
+		}
+	}
+}
+
+static int table_sortby(lua_State* L) noexcept{
+	using namespace TableSort;
+	// Check arguments
+	luaL_checktype(L, 1, LUA_TTABLE);
+	const int key_type = lua_type(L, 2);
+	luaL_argcheck(L, key_type == LUA_TNONE || key_type == LUA_TNIL || key_type == LUA_TSTRING || key_type == LUA_TNUMBER || key_type == LUA_TFUNCTION, 2, "optional field or function expected");
+	const bool stable = luaL_optboolean(L, 3, false),
+		descending = luaL_optboolean(L, 4, false);
+	lua_settop(L, 4);
+	// Extract keys (once per element) into a Lua table, so key errors don't skip C++ destructors
+	const size_t n = lua_rawlen(L, 1);
+	if(n < 2)
+		return 0;
+	lua_createtable(L, n, 0);
+	const int keys = lua_gettop(L);
+	bool numbers = false;
+	for(size_t i = 1; i <= n; ++i){
+		lua_rawgeti(L, 1, i);
+		switch(key_type){
+			case LUA_TSTRING:
+			case LUA_TNUMBER:
+				if(!lua_istable(L, -1))
+					return luaL_error(L, "Element %d isn't a table!", static_cast<int>(i));
+				lua_pushvalue(L, 2);
+				lua_gettable(L, -2);
+				lua_remove(L, -2);
+				break;
+			case LUA_TFUNCTION:
+				lua_pushvalue(L, 2);
+				lua_insert(L, -2);
+				lua_call(L, 1, 1);
+				break;
+		}
+		if(lua_type(L, -1) == LUA_TNUMBER && (i == 1 || numbers)){
+			const lua_Number x = lua_tonumber(L, -1);
+			if(x != x)
+				return luaL_error(L, "Key of element %d is NaN!", static_cast<int>(i));
+			numbers = true;
+		}else if(!(lua_type(L, -1) == LUA_TSTRING && !numbers))
+			return luaL_error(L, "Key of element %d isn't a number or string like the previous ones!", static_cast<int>(i));
+		lua_rawseti(L, keys, i);
+	}
+	// Sort keys & reorder elements by temporary copy
+	bool out_of_memory = false;
+	try{
+		std::vector<size_t> order;
+		order.reserve(n);
+		if(numbers){
+			std::vector<std::pair<uint64_t,size_t>> number_keys;
+			number_keys.reserve(n);
+			for(size_t i = 1; i <= n; ++i){
+				lua_rawgeti(L, keys, i);
+				const uint64_t bits = number_bits(lua_tonumber(L, -1));
+				number_keys.emplace_back(descending ? ~bits : bits, i);
+				lua_pop(L, 1);
+			}
+			if(stable && n >= 256)
+				radix_sort(number_keys);
+			else{
+				const auto less = [](const std::pair<uint64_t,size_t>& a, const std::pair<uint64_t,size_t>& b){return a.first < b.first;};
+				if(stable)
+					std::stable_sort(number_keys.begin(), number_keys.end(), less);
+				else
+					std::sort(number_keys.begin(), number_keys.end(), less);
+			}
+			for(const auto& item : number_keys)
+				order.push_back(item.second);
+		}else{
+			std::vector<std::pair<std::string,size_t>> string_keys;
+			string_keys.reserve(n);
+			for(size_t i = 1; i <= n; ++i){
+				lua_rawgeti(L, keys, i);
+				size_t len;
+				const char* str = lua_tolstring(L, -1, &len);
+				string_keys.emplace_back(std::string(str, len), i);
+				lua_pop(L, 1);
+			}
+			const auto less = [descending](const std::pair<std::string,size_t>& a, const std::pair<std::string,size_t>& b){return descending ? b.first < a.first : a.first < b.first;};
+			if(stable)
+				std::stable_sort(string_keys.begin(), string_keys.end(), less);
+			else
+				std::sort(string_keys.begin(), string_keys.end(), less);
+			for(const auto& item : string_keys)
+				order.push_back(item.second);
+		}
+		lua_createtable(L, n, 0);
+		for(size_t i = 1; i <= n; ++i){
+			lua_rawgeti(L, 1, i);
+			lua_rawseti(L, -2, i);
+		}
+		for(size_t i = 0; i < n; ++i){
+			lua_rawgeti(L, -1, order[i]);
+			lua_rawseti(L, 1, i+1);
+		}
+	}catch(const std::bad_alloc&){
+		out_of_memory = true;
+	}
+	if(out_of_memory)
+		return luaL_error(L, "Not enough memory!");
+	return 0;
+}
+
 int luaopen_tablex(lua_State* L)/* No exception specifier because of C declaration */{
 	static const luaL_Reg l[] = {
 		{"copy", table_copy},
 		{"tostring", table_tostring},
+		{"serialize", table_serialize},
+		{"deserialize", table_deserialize},
 		{"alloc", table_allocate},
 		{"compare", table_compare},
 		{"count", table_count},
@@ -374,6 +807,7 @@ int luaopen_tablex(lua_State* L)/* No exception specifier because of C declarati
 		{"insertn", table_insertn},
 		{"removen", table_removen},
 		{"move", table_move},
+		{"sortby", table_sortby},
 		{NULL, NULL}
 	};
 	lua_getglobal(L, "table");
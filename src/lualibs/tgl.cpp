@@ -18,6 +18,7 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "../GL/glfw.hpp"
 #include <mutex>
 #include "../GL/gl.h"
+#include "../utils/numarray.hpp"
 #include <vector>
 #include <algorithm>
 #include <cassert>
@@ -278,7 +279,9 @@ static int tgl_vao_create(lua_State* L) noexcept{
 	TGL_CONTEXT_CHECK
 	// Check arguments
 	luaL_checktype(L, 1, LUA_TTABLE);
-	luaL_checktype(L, 2, LUA_TTABLE);
+	const NumArray::Array* arr = lua_tonumarray(L, 2);
+	if(!arr)
+		luaL_checktype(L, 2, LUA_TTABLE);
 	// Get properties
 	struct Property{
 		int location_index, vertex_size;
@@ -297,21 +300,30 @@ static int tgl_vao_create(lua_State* L) noexcept{
 			return luaL_error(L, "Properties have to be tables!");
 		lua_pop(L, 1);
 	}
-	// Convert data to vector
-	std::vector<float> data(lua_rawlen(L, 2));
-	for(size_t i = 1; i <= data.size(); ++i){
-		lua_rawgeti(L, 2, i);
-		if(!lua_isnumber(L, -1))
-			return luaL_error(L, "Data must contain numbers only!");
-		data[i-1] = lua_tonumber(L, -1);
-		lua_pop(L, 1);
+	// Convert data to vector (float arrays can be uploaded directly)
+	std::vector<float> data;
+	if(arr){
+		if(arr->get_type() != NumArray::Type::FLOAT32){
+			data.resize(arr->size());
+			arr->copy_to(data.data(), 0, data.size());
+		}
+	}else{
+		data.resize(lua_rawlen(L, 2));
+		for(size_t i = 1; i <= data.size(); ++i){
+			lua_rawgeti(L, 2, i);
+			if(!lua_isnumber(L, -1))
+				return luaL_error(L, "Data must contain numbers only!");
+			data[i-1] = lua_tonumber(L, -1);
+			lua_pop(L, 1);
+		}
 	}
+	const bool data_direct = arr && arr->get_type() == NumArray::Type::FLOAT32;
 	// Create VBO
 	GLuint vbo;
 	glGenBuffers(1, &vbo);
 	// Fill VBO
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, data.size() << 2, data.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, data_direct ? arr->bytes() : data.size() << 2, data_direct ? arr->data() : data.data(), GL_STATIC_DRAW);
 	if(glGetError_s()){
 		glDeleteBuffers(1, &vbo);
 		return luaL_error(L, "Couldn't allocate memory for VBO data!");
@@ -478,6 +490,44 @@ static int tgl_texture_data(lua_State* L) noexcept{
 	return 3;
 }
 
+unsigned char* lua_texture_map(lua_State* L, int arg, unsigned width, unsigned height, bool has_alpha) noexcept{
+	GLuint* udata = static_cast<GLuint*>(luaL_testudata(L, arg, LUA_TGL_TEXTURE));
+	if(!udata || !glfwGetCurrentContext())
+		return nullptr;
+	// Create PBO (shared with data readback) & orphan its storage for new pixels
+	if(!udata[1])
+		glGenBuffers(1, &udata[1]);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, udata[1]);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * (has_alpha ? 4 : 3), nullptr, GL_STREAM_DRAW);
+	GLvoid* pbo_map = glGetError_s() ? nullptr : glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	if(!pbo_map){
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return nullptr;
+	}
+	// Remember upload format for unmapping
+	udata[2] = width, udata[3] = height, udata[4] = has_alpha;
+	return static_cast<unsigned char*>(pbo_map);
+}
+
+bool lua_texture_unmap(lua_State* L, int arg) noexcept{
+	const GLuint* udata = static_cast<GLuint*>(luaL_testudata(L, arg, LUA_TGL_TEXTURE));
+	if(!udata || !glfwGetCurrentContext())
+		return false;
+	// Upload packed BGR(A) rows from PBO into texture
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, udata[1]);
+	const bool success = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	if(success){
+		GLuint old_tex;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, reinterpret_cast<GLint*>(&old_tex));
+		glBindTexture(GL_TEXTURE_2D, udata[0]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, udata[4] ? GL_RGBA : GL_RGB, udata[2], udata[3], 0, udata[4] ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+		glBindTexture(GL_TEXTURE_2D, old_tex);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return success && !glGetError_s();
+}
+
 static int tgl_texture_bind(lua_State* L) noexcept{
 	TGL_CONTEXT_CHECK
 	// Set active texture
@@ -497,8 +547,9 @@ static int tgl_texture_create(lua_State* L) noexcept{
 	static const char* option_str[] = {"rgb", "bgr", "rgba", "bgra", nullptr};
 	static const GLenum option_enum[] = {GL_RGB, GL_BGR, GL_RGBA, GL_BGRA};
 	const GLenum format = option_enum[luaL_checkoption(L, 3, nullptr, option_str)];
-	size_t data_len;
-	const char* data = luaL_optlstring(L, 4, nullptr, &data_len);
+	size_t data_len = 0;
+	const char* data = lua_isnoneornil(L, 4) ? nullptr : lua_tobytes(L, 4, &data_len);
+	luaL_argcheck(L, data || lua_isnoneornil(L, 4), 4, "optional string or mapped file expected");
 	// Check arguments
 	if(width <= 0 || height <= 0)
 		return luaL_error(L, "Invalid dimensions!");
@@ -523,9 +574,10 @@ static int tgl_texture_create(lua_State* L) noexcept{
 	// Restore old texture binding
 	glBindTexture(GL_TEXTURE_2D, old_tex);
 	// Create userdata for texture
-	GLuint* udata = static_cast<GLuint*>(lua_newuserdata(L, sizeof(GLuint) << 1));
+	GLuint* udata = static_cast<GLuint*>(lua_newuserdata(L, sizeof(GLuint) * 5));
 	udata[0] = tex;
 	udata[1] = 0;	// Reserved for PBO on data access
+	udata[2] = udata[3] = udata[4] = 0;	// Reserved for mapped upload format
 	// Fetch/create Lua tgl texture metatable
 	if(luaL_newmetatable(L, LUA_TGL_TEXTURE)){
 		static const luaL_Reg l[] = {
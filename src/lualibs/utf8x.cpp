@@ -14,6 +14,10 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #include "libs.h"
 #include "../utils/lua.h"
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
 
 // Helpers
 static unsigned charsize(const unsigned char c) noexcept{
@@ -34,6 +38,104 @@ static bool checkchar(const unsigned char* c) noexcept{
 		(cn < 4 || (c[3] >= 0x80 && c[3] <= 0xbf));
 }
 
+// Counts characters of valid utf-8 string until null-character or length (false on invalid byte sequence)
+static bool utf8_count(const char* s, const size_t len, size_t& n) noexcept{
+	static const uint64_t low_bits = 0x0101010101010101ull, high_bits = 0x8080808080808080ull;
+	const char* const end = s + len;
+	n = 0;
+	while(s < end){
+		// Fast path: 8 ascii characters (no high bits, no zeros) per step
+		uint64_t word;
+		while(end - s >= static_cast<ptrdiff_t>(sizeof(word))){
+			std::memcpy(&word, s, sizeof(word));
+			if((word | ((word - low_bits) & ~word)) & high_bits)
+				break;
+			s += sizeof(word), n += sizeof(word);
+		}
+		// Slow path: single (multibyte) character
+		if(s == end || *s == '\0')
+			break;
+		if(!checkchar(reinterpret_cast<const unsigned char*>(s)))
+			return false;
+		s += charsize(*s), ++n;
+	}
+	return true;
+}
+
+static uint32_t codepoint(const unsigned char* c) noexcept{
+	switch(charsize(*c)){
+		case 1: return *c;
+		case 2: return (*c & 0x1f) << 6 | (c[1] & 0x3f);
+		case 3: return (*c & 0x0f) << 12 | (c[1] & 0x3f) << 6 | (c[2] & 0x3f);
+		default: return (*c & 0x07) << 18 | (c[1] & 0x3f) << 12 | (c[2] & 0x3f) << 6 | (c[3] & 0x3f);
+	}
+}
+
+// Unique name for Lua metatable
+#define LUA_UTF8_INDEX "utf8_index"
+
+// Userdata container
+struct Utf8Index{
+	const std::string data;
+	std::vector<uint32_t> offsets;	// Byte offset of every character + end
+};
+
+// Converts (negative) character position into 1-based position (0 if out of range)
+static size_t utf8_index_pos(const Utf8Index* index, lua_Integer i) noexcept{
+	const lua_Integer n = index->offsets.size() - 1;
+	if(i < 0)
+		i += n + 1;
+	return i < 1 || i > n ? 0 : i;
+}
+
+// Utf-8 index metatable methods
+static int utf8_index_free(lua_State* L) noexcept{
+	delete *static_cast<Utf8Index**>(luaL_checkudata(L, 1, LUA_UTF8_INDEX));
+	return 0;
+}
+
+static int utf8_index_len(lua_State* L) noexcept{
+	lua_pushinteger(L, (*static_cast<Utf8Index**>(luaL_checkudata(L, 1, LUA_UTF8_INDEX)))->offsets.size() - 1);
+	return 1;
+}
+
+static int utf8_index_offset(lua_State* L) noexcept{
+	const Utf8Index* index = *static_cast<Utf8Index**>(luaL_checkudata(L, 1, LUA_UTF8_INDEX));
+	const size_t pos = utf8_index_pos(index, luaL_checkinteger(L, 2));
+	if(pos == 0)
+		return 0;
+	lua_pushinteger(L, 1+index->offsets[pos-1]);
+	lua_pushinteger(L, index->offsets[pos] - index->offsets[pos-1]);
+	return 2;
+}
+
+static int utf8_index_sub(lua_State* L) noexcept{
+	const Utf8Index* index = *static_cast<Utf8Index**>(luaL_checkudata(L, 1, LUA_UTF8_INDEX));
+	lua_Integer i = luaL_optinteger(L, 2, 1),
+		j = luaL_optinteger(L, 3, -1);
+	// Clamp range like string.sub
+	const lua_Integer n = index->offsets.size() - 1;
+	if(i < 0)
+		i = i + n + 1 < 1 ? 1 : i + n + 1;
+	else if(i == 0)
+		i = 1;
+	if(j < 0)
+		j += n + 1;
+	else if(j > n)
+		j = n;
+	if(i > j)
+		lua_pushliteral(L, "");
+	else
+		lua_pushlstring(L, index->data.data() + index->offsets[i-1], index->offsets[j] - index->offsets[i-1]);
+	return 1;
+}
+
+static int utf8_index_string(lua_State* L) noexcept{
+	const Utf8Index* index = *static_cast<Utf8Index**>(luaL_checkudata(L, 1, LUA_UTF8_INDEX));
+	lua_pushlstring(L, index->data.data(), index->offsets.back());
+	return 1;
+}
+
 // General functions
 static int utf8_charrange(lua_State* L) noexcept{
 	// Get arguments
@@ -51,38 +153,100 @@ static int utf8_charrange(lua_State* L) noexcept{
 }
 
 static int utf8_chars(lua_State* L) noexcept{
-	luaL_checktype(L, 1, LUA_TSTRING);
+	// Validate once, iterate without checks
+	size_t len, n;
+	const char* s = luaL_checklstring(L, 1, &len);
+	if(!utf8_count(s, len, n))
+		return luaL_error(L, "Invalid byte sequence found!");
+	lua_settop(L, 1);
+	lua_pushlightuserdata(L, const_cast<char*>(s));	// String stays referenced by first upvalue
 	lua_pushinteger(L, 0);
 	lua_pushcclosure(L, [](lua_State* L){
-		const int i = lua_tointeger(L, lua_upvalueindex(2));
-		const char* s = lua_tostring(L, lua_upvalueindex(1)) + i;
+		const int i = lua_tointeger(L, lua_upvalueindex(3));
+		const char* s = static_cast<const char*>(lua_touserdata(L, lua_upvalueindex(2))) + i;
 		if(*s == '\0')
 			return 0;
-		if(!checkchar(reinterpret_cast<const unsigned char*>(s)))
-			return luaL_error(L, "Invalid byte sequence found!");
 		const unsigned cn = charsize(*s);
 		lua_pushlstring(L, s, cn);
 		lua_pushinteger(L, 1+i);
-		lua_pushinteger(L, i+cn); lua_replace(L, lua_upvalueindex(2));
+		lua_pushinteger(L, i+cn); lua_replace(L, lua_upvalueindex(3));
 		return 2;
-	}, 2);
+	}, 3);
 	return 1;
 }
 
 static int utf8_len(lua_State* L) noexcept{
-	unsigned n = 0;
-	for(const char* s = luaL_checkstring(L, 1); *s != '\0'; s += charsize(*s), ++n)
-		if(!checkchar(reinterpret_cast<const unsigned char*>(s)))
-			return luaL_error(L, "Invalid byte sequence found!");
+	size_t len, n;
+	const char* s = luaL_checklstring(L, 1, &len);
+	if(!utf8_count(s, len, n))
+		return luaL_error(L, "Invalid byte sequence found!");
 	lua_pushinteger(L, n);
 	return 1;
 }
 
+static int utf8_codepoints(lua_State* L) noexcept{
+	size_t len, n;
+	const char* s = luaL_checklstring(L, 1, &len);
+	if(!utf8_count(s, len, n))
+		return luaL_error(L, "Invalid byte sequence found!");
+	lua_createtable(L, n, 0);
+	lua_createtable(L, n, 0);
+	const char* c = s;
+	for(size_t i = 1; i <= n; c += charsize(*c), ++i){
+		lua_pushinteger(L, codepoint(reinterpret_cast<const unsigned char*>(c))); lua_rawseti(L, -3, i);
+		lua_pushinteger(L, 1+(c-s)); lua_rawseti(L, -2, i);
+	}
+	return 2;
+}
+
+static int utf8_index(lua_State* L) noexcept{
+	size_t len, n;
+	const char* s = luaL_checklstring(L, 1, &len);
+	if(!utf8_count(s, len, n))
+		return luaL_error(L, "Invalid byte sequence found!");
+	if(len > UINT32_MAX)
+		return luaL_error(L, "String too long!");
+	// Build offsets table
+	Utf8Index* index;
+	try{
+		index = new Utf8Index{std::string(s, len), std::vector<uint32_t>()};
+		index->offsets.reserve(n+1);
+	}catch(const std::bad_alloc&){
+		return luaL_error(L, "Not enough memory!");
+	}
+	const char* c = s;
+	for(size_t i = 0; i < n; c += charsize(*c), ++i)
+		index->offsets.push_back(c-s);
+	index->offsets.push_back(c-s);
+	// Create index userdata
+	*static_cast<Utf8Index**>(lua_newuserdata(L, sizeof(Utf8Index*))) = index;
+	if(luaL_newmetatable(L, LUA_UTF8_INDEX)){
+		static const luaL_Reg meta[] = {
+			{"__gc", utf8_index_free},
+			{"__len", utf8_index_len},
+			{"__tostring", utf8_index_string},
+			{NULL, NULL}
+		};
+		luaL_setfuncs(L, meta, 0);
+		static const luaL_Reg methods[] = {
+			{"len", utf8_index_len},
+			{"offset", utf8_index_offset},
+			{"sub", utf8_index_sub},
+			{NULL, NULL}
+		};
+		luaL_newlib(L, methods); lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
 int luaopen_utf8x(lua_State* L)/* No exception specifier because of C declaration */{
 	static const luaL_Reg l[] = {
 		{"charrange", utf8_charrange},
 		{"chars", utf8_chars},
 		{"len", utf8_len},
+		{"codepoints", utf8_codepoints},
+		{"index", utf8_index},
 		{NULL, NULL}
 	};
 	lua_getglobal(L, "utf8");
@@ -17,10 +17,33 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "../utils/lua.h"
 #include "../utils/module.hpp"
 #include "../utils/log.hpp"
+#include "../utils/threading.hpp"
+#include "../utils/font.hpp"
+#include <mutex>
 
 #define LSTATE this->L.get()
 
 namespace FLuaG{
+	// Scripts using library services
+	static std::mutex services_mutex;
+	static unsigned services_users = 0;
+
+	Script::Services::Services(){
+		std::lock_guard<std::mutex> lock(services_mutex);
+		++services_users;
+	}
+
+	Script::Services::~Services(){
+		// Locked during release, so no new script starts work on services going down
+		std::lock_guard<std::mutex> lock(services_mutex);
+		if(--services_users == 0){
+			LOG("Release library services...");
+			Font::index().reset();
+			Threading::shutdown();
+			LOG("Library services released!");
+		}
+	}
+
 	Script::Script(){
 		LOG("Default construct script...");
 		// Check Lua state allocation (unsafe C alloc)
@@ -43,6 +66,8 @@ namespace FLuaG{
 					{"tgl", luaopen_tgl},
 					{"font", luaopen_font},
 					{"utf8x", luaopen_utf8x},
+					{"numarray", luaopen_numarray},
+					{"canvas", luaopen_canvas},
 					{NULL, NULL}
 				};
 				luaL_setfuncs(LSTATE, l, 0);
@@ -105,6 +130,8 @@ namespace FLuaG{
 		other.image_rowsize = 0;
 		this->image_height = other.image_height;
 		other.image_height = 0;
+		this->image_has_alpha = other.image_has_alpha;
+		other.image_has_alpha = false;
 		this->userdata.swap(other.userdata);
 #ifdef FLUAG_FORCE_SINGLE_THREAD
 		this->call_context.swap(other.call_context);
@@ -128,6 +155,7 @@ namespace FLuaG{
 		// Save video informations for ProcessFrame function call
 		this->image_height = header.height;
 		this->image_rowsize = header.has_alpha ? header.width << 2 : (header.width << 1) + header.width;
+		this->image_has_alpha = header.has_alpha;
 		LOG("Script got video informations set!");
 	}
 
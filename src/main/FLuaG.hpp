@@ -48,12 +48,21 @@ namespace FLuaG{
 	// Main class
 	class Script{
 		private:
+			// Share of process-wide library services (worker pool, font directory watcher), released with last script
+			// instead of static destruction on module unload (first member, so released after Lua state)
+			struct Services{
+				Services();
+				~Services();
+				Services(const Services&) = delete;
+				Services& operator=(const Services&) = delete;
+			} services;
 			// Lua state
 			using lua_ptr = std::unique_ptr<lua_State, void(*)(lua_State*)>;
 			lua_ptr L = lua_ptr(luaL_newstate(), [](lua_State* L){lua_close(L);});
 			// Video informations required by ProcessFrame function
 			unsigned short image_height = 0;
 			unsigned image_rowsize = 0;
+			bool image_has_alpha = false;
 			// Userdata required by LoadFile function
 			std::string userdata;
 			// Image data to Lua object
@@ -15,6 +15,8 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "FLuaG.hpp"
 #include "../utils/lua.h"
 #include "../utils/imageop.hpp"
+#include "../utils/image.hpp"
+#include "../lualibs/libs.h"
 
 // Unique name for Lua metatable
 #define LUA_IMAGE_DATA "FLuaG_image_data"
@@ -25,8 +27,31 @@ struct ImageData{
 	unsigned rowsize;
 	int stride;
 	unsigned short height;
+	bool has_alpha;
 };
 
+bool lua_toframe(lua_State* L, int arg, Image::View& view) noexcept{
+	ImageData** udata = static_cast<ImageData**>(luaL_testudata(L, arg, LUA_IMAGE_DATA));
+	if(!udata)
+		return false;
+	const ImageData* image = *udata;
+	const std::shared_ptr<unsigned char> data = image->data.lock();
+	if(!data){
+		luaL_error(L, "Data are already dead!");
+		return false;
+	}
+	// Top row first, bottom-up memory by negative stride
+	view = {
+		image->stride < 0 ? data.get() + (image->height - 1) * -image->stride : data.get(),
+		image->rowsize / (image->has_alpha ? 4 : 3),
+		image->height,
+		image->stride,
+		image->has_alpha,
+		false
+	};
+	return true;
+}
+
 // Metatable methods
 static int image_data_delete(lua_State* L) noexcept{
 	delete *static_cast<ImageData**>(luaL_checkudata(L, 1, LUA_IMAGE_DATA));
@@ -69,21 +94,35 @@ static int image_data_access(lua_State* L) noexcept{
 	}
 }
 
+#ifndef _WIN32
+static int image_data_cairo(lua_State* L) noexcept{
+	luaL_checkudata(L, 1, LUA_IMAGE_DATA);
+	return lua_pushcairo(L, 1);
+}
+#endif
+
 #define LSTATE this->L.get()
 
 namespace FLuaG{
 	void Script::lua_pushimage(std::weak_ptr<unsigned char> image_data, const int stride) const noexcept{
 		// Create & push image data as Lua userdata
-		*static_cast<ImageData**>(lua_newuserdata(LSTATE, sizeof(ImageData*))) = new ImageData{image_data, this->image_rowsize, stride, this->image_height};
+		*static_cast<ImageData**>(lua_newuserdata(LSTATE, sizeof(ImageData*))) = new ImageData{image_data, this->image_rowsize, stride, this->image_height, this->image_has_alpha};
 		// Fetch/create Lua image data metatable
 		if(luaL_newmetatable(LSTATE, LUA_IMAGE_DATA)){
-			static const luaL_Reg l[] = {
+			static const luaL_Reg meta[] = {
 				{"__gc", image_data_delete},
 				{"__len", image_data_size},
 				{"__call", image_data_access},
 				{NULL, NULL}
 			};
-			luaL_setfuncs(LSTATE, l, 0);
+			luaL_setfuncs(LSTATE, meta, 0);
+			static const luaL_Reg methods[] = {
+#ifndef _WIN32
+				{"cairo", image_data_cairo},
+#endif
+				{NULL, NULL}
+			};
+			luaL_newlib(LSTATE, methods); lua_setfield(LSTATE, -2, "__index");
 		}
 		// Bind metatable to userdata
 		lua_setmetatable(LSTATE, -2);
@@ -0,0 +1,201 @@
+/*
+Project: FLuaG
+File: filewatch.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <sys/eventfd.h>
+	#include <poll.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+namespace FileWatch{
+	// Watches files & directories for changes in a background thread (inotify on linux, polling elsewhere or on failure)
+	class Watcher{
+		private:
+			// Changes collected by background thread
+			std::atomic<bool> dirty;
+			std::mutex changes_mutex;
+			std::set<std::string> changes;
+			void report(const std::string& path){
+				std::lock_guard<std::mutex> lock(this->changes_mutex);
+				this->changes.insert(path);
+				this->dirty.store(true, std::memory_order_release);
+			}
+			// Background thread control
+			std::thread thread;
+			std::mutex stop_mutex;
+			std::condition_variable stop_cv;
+			bool stop = false;
+#ifdef __linux__
+			int inotify_fd = -1, stop_fd = -1;
+			bool watch_inotify(const std::vector<boost::filesystem::path>& paths){
+				if((this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+					return false;
+				if((this->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0){
+					close(this->inotify_fd);
+					this->inotify_fd = -1;
+					return false;
+				}
+				// Watch directories (files by parent directory to survive replacements by editors)
+				struct Watch{
+					boost::filesystem::path dir;
+					bool all;
+					std::set<std::string> names;
+				};
+				std::map<int, Watch> watches;
+				for(const auto& path : paths){
+					const bool is_dir = boost::filesystem::is_directory(path);
+					const boost::filesystem::path dir = is_dir ? path : path.parent_path();
+					const int wd = inotify_add_watch(this->inotify_fd, dir.c_str(), IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+					if(wd < 0){
+						close(this->inotify_fd);
+						close(this->stop_fd);
+						this->inotify_fd = this->stop_fd = -1;
+						return false;
+					}
+					Watch& watch = watches[wd];
+					watch.dir = dir;
+					if(is_dir)
+						watch.all = true;
+					else
+						watch.names.insert(path.filename().string());
+				}
+				// Wait for kernel events
+				this->thread = std::thread([this,watches](){
+					alignas(inotify_event) char buf[4096];
+					pollfd fds[2] = {{this->inotify_fd, POLLIN, 0}, {this->stop_fd, POLLIN, 0}};
+					for(;;){
+						if(poll(fds, 2, -1) < 0){
+							if(errno == EINTR)
+								continue;
+							break;
+						}
+						if(fds[1].revents & POLLIN)
+							break;
+						ssize_t len;
+						while((len = read(this->inotify_fd, buf, sizeof(buf))) > 0)
+							for(const char* p = buf; p < buf + len; p += sizeof(inotify_event) + reinterpret_cast<const inotify_event*>(p)->len){
+								const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+								// Events lost by full kernel queue, anything could have changed
+								if(event->mask & IN_Q_OVERFLOW){
+									for(const auto& entry : watches){
+										if(entry.second.all)
+											this->report(entry.second.dir.string());
+										for(const auto& name : entry.second.names)
+											this->report((entry.second.dir / name).string());
+									}
+									continue;
+								}
+								const auto it = watches.find(event->wd);
+								if(it == watches.end())
+									continue;
+								const Watch& watch = it->second;
+								if(event->len && watch.names.count(event->name))
+									this->report((watch.dir / event->name).string());
+								if(watch.all)
+									this->report(watch.dir.string());
+							}
+					}
+				});
+				return true;
+			}
+#endif
+			void watch_polling(const std::vector<boost::filesystem::path>& paths, const std::chrono::milliseconds interval){
+				this->thread = std::thread([this,paths,interval](){
+					// File state for comparison
+					typedef std::pair<std::time_t, uintmax_t> State;
+					const auto state = [](const boost::filesystem::path& path){
+						boost::system::error_code ec;
+						const std::time_t mtime = boost::filesystem::last_write_time(path, ec);
+						const uintmax_t size = ec ? 0 : boost::filesystem::is_regular_file(path, ec) ? boost::filesystem::file_size(path, ec) : 0;
+						return ec ? State(-1, 0) : State(mtime, size);
+					};
+					std::vector<State> states;
+					for(const auto& path : paths)
+						states.push_back(state(path));
+					// Compare periodically
+					std::unique_lock<std::mutex> lock(this->stop_mutex);
+					while(!this->stop_cv.wait_for(lock, interval, [this](){return this->stop;}))
+						for(size_t i = 0; i < paths.size(); ++i){
+							const State new_state = state(paths[i]);
+							if(new_state != states[i]){
+								states[i] = new_state;
+								this->report(paths[i].string());
+							}
+						}
+				});
+			}
+		public:
+			// Ctor
+			Watcher(const std::vector<std::string>& paths, const std::chrono::milliseconds poll_interval = std::chrono::milliseconds(500)) : dirty(false){
+				std::vector<boost::filesystem::path> abs_paths;
+				for(const auto& path : paths)
+					abs_paths.push_back(boost::filesystem::absolute(path));
+#ifdef __linux__
+				if(!this->watch_inotify(abs_paths))
+#endif
+				this->watch_polling(abs_paths, poll_interval);
+			}
+			// No copy
+			Watcher(const Watcher&) = delete;
+			Watcher& operator=(const Watcher&) = delete;
+			// Dtor
+			~Watcher(){
+				{
+					std::lock_guard<std::mutex> lock(this->stop_mutex);
+					this->stop = true;
+				}
+				this->stop_cv.notify_all();
+#ifdef __linux__
+				if(this->stop_fd >= 0){
+					const uint64_t one = 1;
+					if(write(this->stop_fd, &one, sizeof(one)) < 0){}
+				}
+#endif
+				if(this->thread.joinable())
+					this->thread.join();
+#ifdef __linux__
+				if(this->inotify_fd >= 0){
+					close(this->inotify_fd);
+					close(this->stop_fd);
+				}
+#endif
+			}
+			// Any changes since last fetch? (no system call)
+			bool changed() const noexcept{
+				return this->dirty.load(std::memory_order_acquire);
+			}
+			// Fetch & reset changed paths
+			std::vector<std::string> fetch(){
+				std::lock_guard<std::mutex> lock(this->changes_mutex);
+				std::vector<std::string> result(this->changes.begin(), this->changes.end());
+				this->changes.clear();
+				this->dirty.store(false, std::memory_order_release);
+				return result;
+			}
+	};
+}
@@ -0,0 +1,211 @@
+/*
+Project: FLuaG
+File: filter.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "image.hpp"
+#include "threading.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#ifndef FILTER_STRIP
+	#define FILTER_STRIP 16	// Pixel columns per vertical pass task (one cache line of BGRA)
+#endif
+
+namespace Filter{
+	// Scratch memory of one task
+	struct Workspace{
+		std::vector<float> sums;
+		std::vector<unsigned char> a, b, c, passes[2];
+	};
+
+	// Runs function over ranges of [0,n) split on process-wide thread pool (threads <= 1 runs in caller)
+	template<typename F>
+	inline void parallel(const unsigned n, unsigned threads, const F& func){
+		threads = std::max(1u, std::min({threads, static_cast<unsigned>(Threading::pool().size()), n}));
+		if(threads == 1)
+			return func(0, n);
+		const unsigned chunk = (n + threads - 1) / threads;
+		std::vector<std::future<void>> results;
+		for(unsigned first = 0; first < n; first += chunk)
+			results.push_back(Threading::pool().enqueue([&func,first,chunk,n](){func(first, std::min(first + chunk, n));}));
+		for(auto& result : results)	// All done before any error leaves (tasks reference arguments)
+			result.wait();
+		for(auto& result : results)
+			result.get();
+	}
+
+	// Line kernels over n samples of interleaved lanes, window of 2r+1 samples, edges repeated (source & destination differ).
+	// Lanes as template argument unrolls pixel-wise lines, 0 takes the runtime count (column strips).
+	template<unsigned Lanes>
+	inline void box_line(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned runtime_lanes, const unsigned r, Workspace& ws){
+		const unsigned lanes = Lanes ? Lanes : runtime_lanes;
+		ws.sums.assign(lanes, 0);
+		float* const sums = ws.sums.data();
+		const auto at = [src,n,lanes](const long i){return src + std::max(0l, std::min(static_cast<long>(n) - 1, i)) * lanes;};
+		for(long i = -static_cast<long>(r); i <= static_cast<long>(r); ++i){
+			const unsigned char* p = at(i);
+			for(unsigned l = 0; l < lanes; ++l)
+				sums[l] += p[l];
+		}
+		const float scale = 1.0f / (2 * r + 1);
+		const auto step = [sums,scale,lanes](unsigned char* out, const unsigned char* add, const unsigned char* sub){
+			for(unsigned l = 0; l < lanes; ++l){
+				out[l] = static_cast<unsigned char>(sums[l] * scale + 0.5f);
+				sums[l] += static_cast<int>(add[l]) - sub[l];
+			}
+		};
+		// Clamped edges around unclamped interior
+		const size_t inner_first = std::min(static_cast<size_t>(r), n),
+			inner_last = std::max(inner_first, n > r + 1 ? n - r - 1 : 0);
+		size_t x = 0;
+		for(; x < inner_first; ++x)
+			step(dst + x * lanes, at(x + r + 1), at(static_cast<long>(x) - r));
+		for(; x < inner_last; ++x)
+			step(dst + x * lanes, src + (x + r + 1) * lanes, src + (x - r) * lanes);
+		for(; x < n; ++x)
+			step(dst + x * lanes, at(x + r + 1), at(static_cast<long>(x) - r));
+	}
+	// Van Herk/Gil-Werman: block-wise prefix & suffix extremes, 3 comparisons per sample for any radius
+	template<bool max, unsigned Lanes>
+	inline void extreme_line(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned runtime_lanes, const unsigned r, Workspace& ws){
+		const unsigned lanes = Lanes ? Lanes : runtime_lanes;
+		const size_t w = 2 * r + 1, m = n + 2 * r;
+		ws.a.resize(m * lanes), ws.b.resize(m * lanes), ws.c.resize(m * lanes);
+		unsigned char* const ext = ws.a.data(), *const g = ws.b.data(), *const h = ws.c.data();
+		const auto op = [](const unsigned char a, const unsigned char b) -> unsigned char{return max ? std::max(a, b) : std::min(a, b);};
+		// Extend edges
+		for(size_t i = 0; i < m; ++i)
+			std::memcpy(ext + i * lanes, src + std::min(n - 1, i < r ? 0 : i - r) * lanes, lanes);
+		// Prefix extremes from block starts, suffix extremes from block ends
+		for(size_t i = 0; i < m; ++i)
+			if(i % w)
+				for(unsigned l = 0; l < lanes; ++l)
+					g[i * lanes + l] = op(g[(i-1) * lanes + l], ext[i * lanes + l]);
+			else
+				std::memcpy(g + i * lanes, ext + i * lanes, lanes);
+		for(size_t i = m; i-- > 0;)
+			if(i + 1 == m || (i + 1) % w == 0)
+				std::memcpy(h + i * lanes, ext + i * lanes, lanes);
+			else
+				for(unsigned l = 0; l < lanes; ++l)
+					h[i * lanes + l] = op(h[(i+1) * lanes + l], ext[i * lanes + l]);
+		// Window [x, x+w) of extended line combines suffix of one block with prefix of next
+		const unsigned char* const g_end = g + (w - 1) * lanes;
+		for(size_t i = 0, count = n * lanes; i < count; ++i)
+			dst[i] = op(h[i], g_end[i]);
+	}
+	// Line kernel of runtime lanes dispatched to unrolled pixel widths
+	template<template<unsigned> class Line>
+	inline void line_dispatch(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, const unsigned r, Workspace& ws){
+		switch(lanes){
+			case 3: return Line<3>::apply(src, dst, n, lanes, r, ws);
+			case 4: return Line<4>::apply(src, dst, n, lanes, r, ws);
+			default: return Line<0>::apply(src, dst, n, lanes, r, ws);
+		}
+	}
+	template<unsigned Lanes>
+	struct BoxLine{
+		static void apply(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, const unsigned r, Workspace& ws){box_line<Lanes>(src, dst, n, lanes, r, ws);}
+	};
+	template<unsigned Lanes>
+	struct MaxLine{
+		static void apply(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, const unsigned r, Workspace& ws){extreme_line<true,Lanes>(src, dst, n, lanes, r, ws);}
+	};
+	template<unsigned Lanes>
+	struct MinLine{
+		static void apply(const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, const unsigned r, Workspace& ws){extreme_line<false,Lanes>(src, dst, n, lanes, r, ws);}
+	};
+	// Gaussian approximation by 3 box passes (sizes after Kovesi)
+	inline std::vector<unsigned> gaussian_radii(const double sigma){
+		const int passes = 3;
+		int wl = std::floor(std::sqrt(12 * sigma * sigma / passes + 1));
+		if(!(wl & 1))
+			--wl;
+		const int m = std::round((12 * sigma * sigma - passes * wl * wl - 4 * passes * wl - 3 * passes) / (-4 * wl - 4));
+		std::vector<unsigned> radii;
+		for(int i = 0; i < passes; ++i)
+			radii.push_back(((i < m ? wl : wl + 2) - 1) / 2);
+		return radii;
+	}
+
+	// Applies line kernels horizontally (row bands) and vertically (column strips), each as kernel(src, dst, samples, lanes, workspace)
+	template<typename KernelX, typename KernelY>
+	inline void separable(const Image::View& image, const unsigned threads, const bool horizontal, const KernelX& kernel_x, const bool vertical, const KernelY& kernel_y){
+		if(!image.width || !image.height)
+			return;
+		const unsigned channels = image.channels();
+		if(horizontal)
+			parallel(image.height, threads, [&image,channels,&kernel_x](const unsigned first, const unsigned last){
+				Workspace ws;
+				std::vector<unsigned char> line(image.width * channels);
+				for(unsigned y = first; y < last; ++y){
+					std::memcpy(line.data(), image.row(y), line.size());
+					kernel_x(line.data(), image.row(y), image.width, channels, ws);
+				}
+			});
+		if(vertical)
+			parallel((image.width + FILTER_STRIP - 1) / FILTER_STRIP, threads, [&image,channels,&kernel_y](const unsigned first, const unsigned last){
+				Workspace ws;
+				std::vector<unsigned char> in, out;
+				for(unsigned strip = first; strip < last; ++strip){
+					const unsigned x = strip * FILTER_STRIP,
+						lanes = std::min(static_cast<unsigned>(FILTER_STRIP), image.width - x) * channels;
+					in.resize(image.height * lanes), out.resize(image.height * lanes);
+					for(unsigned y = 0; y < image.height; ++y)
+						std::memcpy(in.data() + y * lanes, image.row(y) + x * channels, lanes);
+					kernel_y(in.data(), out.data(), image.height, lanes, ws);
+					for(unsigned y = 0; y < image.height; ++y)
+						std::memcpy(image.row(y) + x * channels, out.data() + y * lanes, lanes);
+				}
+			});
+	}
+	// Same line kernel with radius per direction
+	template<typename Kernel>
+	inline void separable(const Image::View& image, const unsigned rx, const unsigned ry, const unsigned threads, const Kernel& kernel){
+		separable(image, threads,
+			rx > 0, [rx,&kernel](const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, Workspace& ws){kernel(src, dst, n, lanes, rx, ws);},
+			ry > 0, [ry,&kernel](const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, Workspace& ws){kernel(src, dst, n, lanes, ry, ws);}
+		);
+	}
+
+	// Filters in place (all channels; alpha-weighted results need premultiplied colors like canvases have)
+	inline void box_blur(const Image::View& image, const unsigned rx, const unsigned ry, const unsigned threads = 1){
+		separable(image, rx, ry, threads, line_dispatch<BoxLine>);
+	}
+	inline void gaussian_blur(const Image::View& image, const double sigma_x, const double sigma_y, const unsigned threads = 1){
+		// All box passes of one direction while a line stays in cache
+		const auto kernel = [](const std::vector<unsigned> radii){
+			return [radii](const unsigned char* src, unsigned char* dst, const size_t n, const unsigned lanes, Workspace& ws){
+				ws.passes[0].resize(n * lanes), ws.passes[1].resize(n * lanes);
+				line_dispatch<BoxLine>(src, ws.passes[0].data(), n, lanes, radii[0], ws);
+				line_dispatch<BoxLine>(ws.passes[0].data(), ws.passes[1].data(), n, lanes, radii[1], ws);
+				line_dispatch<BoxLine>(ws.passes[1].data(), dst, n, lanes, radii[2], ws);
+			};
+		};
+		separable(image, threads,
+			sigma_x > 0, kernel(gaussian_radii(std::max(sigma_x, 0.0))),
+			sigma_y > 0, kernel(gaussian_radii(std::max(sigma_y, 0.0)))
+		);
+	}
+	inline void dilate(const Image::View& image, const unsigned rx, const unsigned ry, const unsigned threads = 1){
+		separable(image, rx, ry, threads, line_dispatch<MaxLine>);
+	}
+	inline void erode(const Image::View& image, const unsigned rx, const unsigned ry, const unsigned threads = 1){
+		separable(image, rx, ry, threads, line_dispatch<MinLine>);
+	}
+}
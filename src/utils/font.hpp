@@ -17,12 +17,21 @@ Permission is granted to anyone to use this software for any purpose, including
 #include <exception>
 #include <string>
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <tuple>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include "lru.hpp"
+#include "math.hpp"
+#include "filewatch.hpp"
 #ifdef _WIN32
 	#include "../utils/textconv.hpp"
 	#include <wingdi.h>
 #else
 	#include <fontconfig/fontconfig.h>
-	#include <memory>
 	#include <pango/pangocairo.h>
 #endif
 #include <cassert>
@@ -30,6 +39,12 @@ Permission is granted to anyone to use this software for any purpose, including
 #ifndef FONT_UPSCALE
 	#define FONT_UPSCALE 64.0
 #endif
+#ifndef FONT_CACHE_SIZE
+	#define FONT_CACHE_SIZE 512	// Texts per font for widths and paths each
+#endif
+#ifndef FONT_POOL_SIZE
+	#define FONT_POOL_SIZE 64	// Font styles kept alive by pool
+#endif
 
 namespace Font{
 	// Simple local exception
@@ -61,7 +76,7 @@ namespace Font{
 		return 1;
 	}
 #endif
-	inline std::vector<ListEntry> list(){
+	inline std::vector<ListEntry> list(std::vector<std::string>* dirs = nullptr){
 		std::vector<ListEntry> result;
 #ifdef _WIN32
 		const HDC hdc = CreateCompatibleDC(NULL);
@@ -71,12 +86,19 @@ namespace Font{
 		lf.lfCharSet = DEFAULT_CHARSET;
 		EnumFontFamiliesExW(hdc, &lf, enumfontcallback, reinterpret_cast<LPARAM>(&result), 0);
 		DeleteDC(hdc);
+		// Font directory
+		if(dirs){
+			wchar_t windir[MAX_PATH];
+			const UINT windir_len = GetWindowsDirectoryW(windir, MAX_PATH);
+			if(windir_len && windir_len < MAX_PATH)
+				dirs->push_back(Utf8::from_utf16(std::wstring(windir, windir_len) + L"\\Fonts"));
+		}
 #else
 		// Get font list from FontConfig
-		FcConfig* fc = FcInitLoadConfigAndFonts();
+		const std::unique_ptr<FcConfig, void(*)(FcConfig*)> fc(FcInitLoadConfigAndFonts(), FcConfigDestroy);
 		const std::unique_ptr<FcPattern, void(*)(FcPattern*)> pattern(FcPatternCreate(), FcPatternDestroy);
-		const std::unique_ptr<FcObjectSet, void(*)(FcObjectSet*)> objset(FcObjectSetBuild(FC_FAMILY, FC_STYLE, FC_FILE, FC_OUTLINE, nullptr), FcObjectSetDestroy);
-		const std::unique_ptr<FcFontSet, void(*)(FcFontSet*)> fontlist(FcFontList(fc, pattern.get(), objset.get()), FcFontSetDestroy);
+		const std::unique_ptr<FcObjectSet, void(*)(FcObjectSet*)> objset(FcObjectSetBuild(FC_FAMILY, FC_STYLE, FC_FILE, FC_OUTLINE, FC_LANG, nullptr), FcObjectSetDestroy);
+		const std::unique_ptr<FcFontSet, void(*)(FcFontSet*)> fontlist(FcFontList(fc.get(), pattern.get(), objset.get()), FcFontSetDestroy);
 		if(!fontlist)
 			throw exception("Couldn't create font list!");
 		// Add font list to output
@@ -89,141 +111,325 @@ namespace Font{
 			FcPatternGetString(font, FC_STYLE, 0, &sresult); entry.style = reinterpret_cast<char*>(sresult);
 			FcPatternGetString(font, FC_FILE, 0, &sresult); entry.file = reinterpret_cast<char*>(sresult);
 			FcPatternGetBool(font, FC_OUTLINE, 0, &bresult); entry.outline = bresult;
+			// No script names like on Windows, so supported languages instead ('|'-separated tags)
+			FcLangSet* langs;
+			if(FcPatternGetLangSet(font, FC_LANG, 0, &langs) == FcResultMatch){
+				const std::unique_ptr<FcStrSet, void(*)(FcStrSet*)> lang_set(FcLangSetGetLangs(langs), FcStrSetDestroy);
+				const std::unique_ptr<FcStrList, void(*)(FcStrList*)> lang_list(lang_set ? FcStrListCreate(lang_set.get()) : nullptr, FcStrListDone);
+				if(lang_list)
+					for(const FcChar8* lang; (lang = FcStrListNext(lang_list.get()));){
+						if(!entry.script.empty())
+							entry.script += '|';
+						entry.script += reinterpret_cast<const char*>(lang);
+					}
+			}
 			result.push_back(std::move(entry));
 		}
+		// Font directories
+		if(dirs){
+			const std::unique_ptr<FcStrList, void(*)(FcStrList*)> dir_list(FcConfigGetFontDirs(fc.get()), FcStrListDone);
+			if(dir_list)
+				for(const FcChar8* dir; (dir = FcStrListNext(dir_list.get()));)
+					dirs->push_back(reinterpret_cast<const char*>(dir));
+		}
 #endif
 		return result;
 	}
 
-	// Native font class
+	// Process-wide font list, enumerated again only after font directory changes, with lookup by lowercase family
+	class Index{
+		private:
+			std::mutex mutex;
+			std::shared_ptr<const std::vector<ListEntry>> entries;
+			std::multimap<std::string, size_t> families;
+			std::unique_ptr<FileWatch::Watcher> watcher;
+			static std::string lower(std::string s){
+				std::transform(s.begin(), s.end(), s.begin(), [](const char c){return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;});
+				return s;
+			}
+			// Lowercase script matches whole entry script (Windows) or one of its '|'-separated language tags (FontConfig)
+			static bool script_match(const std::string& entry_script, const std::string& lower_script){
+				const std::string scripts = lower(entry_script);
+				for(size_t first = 0;;){
+					const size_t last = std::min(scripts.find('|', first), scripts.size());
+					if(scripts.compare(first, last - first, lower_script) == 0)
+						return true;
+					if(last == scripts.size())
+						return false;
+					first = last + 1;
+				}
+			}
+			void update(){
+				if(this->entries && !(this->watcher && this->watcher->changed()))
+					return;
+				if(this->watcher)
+					this->watcher->fetch();
+				std::vector<std::string> dirs;
+				this->entries = std::make_shared<const std::vector<ListEntry>>(list(&dirs));
+				this->families.clear();
+				for(size_t i = 0; i < this->entries->size(); ++i)
+					this->families.emplace(lower((*this->entries)[i].family), i);
+				// Watch existing directories once
+				if(!this->watcher){
+					dirs.erase(std::remove_if(dirs.begin(), dirs.end(), [](const std::string& dir){
+						boost::system::error_code ec;
+						return !boost::filesystem::is_directory(dir, ec);
+					}), dirs.end());
+					if(!dirs.empty())
+						this->watcher.reset(new FileWatch::Watcher(dirs, std::chrono::seconds(5)));
+				}
+			}
+		public:
+			// All entries (shared, no copy)
+			std::shared_ptr<const std::vector<ListEntry>> all(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->update();
+				return this->entries;
+			}
+			// Entries by family, optionally also style & script (case-insensitive)
+			std::vector<ListEntry> find(const std::string& family, const std::string& style = "", const std::string& script = ""){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->update();
+				const std::string lower_style = lower(style), lower_script = lower(script);
+				std::vector<ListEntry> result;
+				const auto range = this->families.equal_range(lower(family));
+				for(auto it = range.first; it != range.second; ++it){
+					const ListEntry& entry = (*this->entries)[it->second];
+					if((style.empty() || lower(entry.style) == lower_style) && (script.empty() || script_match(entry.script, lower_script)))
+						result.push_back(entry);
+				}
+				return result;
+			}
+			// Drops entries & stops directory watching (next access lists again)
+			void reset(){
+				std::unique_ptr<FileWatch::Watcher> watcher;
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					watcher.swap(this->watcher);
+					this->entries.reset();
+					this->families.clear();
+				}
+			}
+	};
+	// Process-wide index (never destroyed statically, its watcher thread gets joined by reset)
+	inline Index& index(){
+		static Index* instance = new Index;
+		return *instance;
+	}
+
+	// Native font class (immutable font description, layout contexts per thread for concurrent use)
 	class Font{
 		private:
 			// Attributes
 #ifdef _WIN32
-			HDC dc;
-			HGDIOBJ old_font;
+			HFONT font;
 			double spacing;
 #else
-			cairo_t* ctx;
-			PangoLayout* layout;
+			PangoFontDescription* font_desc;
+			PangoAttrList* attr_list;
+#endif
+			bool rtl;
+			// Layout contexts by thread (a context is only used by its thread, the set is guarded and shared with thread exit cleanup)
+#ifdef _WIN32
+			struct Context{
+				HDC dc;
+				HGDIOBJ old_font;
+			};
+#else
+			struct Context{
+				cairo_t* ctx;
+				PangoLayout* layout;
+			};
+#endif
+			struct ContextSet{
+				std::mutex mutex;
+				std::map<std::thread::id, Context> contexts;
+			};
+			std::shared_ptr<ContextSet> contexts;	// Null for invalid fonts
+			// Context sets the calling thread has an entry in, its entries get destroyed at thread exit
+			class ThreadContexts{
+				private:
+					const std::thread::id id = std::this_thread::get_id();
+					std::vector<std::weak_ptr<ContextSet>> sets;
+				public:
+					void add(const std::shared_ptr<ContextSet>& set){
+						this->sets.erase(std::remove_if(this->sets.begin(), this->sets.end(), [](const std::weak_ptr<ContextSet>& set){return set.expired();}), this->sets.end());
+						this->sets.push_back(set);
+					}
+					~ThreadContexts(){
+						for(const auto& weak_set : this->sets){
+							const std::shared_ptr<ContextSet> set = weak_set.lock();
+							if(set){
+								std::lock_guard<std::mutex> lock(set->mutex);
+								const auto it = set->contexts.find(this->id);
+								if(it != set->contexts.end()){
+									destroy_context(it->second);
+									set->contexts.erase(it);
+								}
+							}
+						}
+					}
+			};
+			static ThreadContexts& thread_contexts(){
+				static thread_local ThreadContexts instance;
+				return instance;
+			}
+			Context create_context() const{
+				Context context;
+#ifdef _WIN32
+				if(!(context.dc = CreateCompatibleDC(NULL)))
+					throw exception("Couldn't create device context!");
+				SetMapMode(context.dc, MM_TEXT);
+				SetBkMode(context.dc, TRANSPARENT);
+				if(this->rtl)
+					SetTextAlign(context.dc, TA_RTLREADING);
+				context.old_font = SelectObject(context.dc, this->font);
+#else
+				cairo_surface_t* surf = cairo_image_surface_create(CAIRO_FORMAT_A1, 1, 1);
+				if(!surf)
+					throw exception("Couldn't create cairo surface!");
+				if(!(context.ctx = cairo_create(surf))){
+					cairo_surface_destroy(surf);
+					throw exception("Couldn't create cairo context!");
+				}
+				if(!(context.layout = pango_cairo_create_layout(context.ctx))){
+					cairo_destroy(context.ctx);
+					cairo_surface_destroy(surf);
+					throw exception("Couldn't create pango layout!");
+				}
+				pango_layout_set_font_description(context.layout, this->font_desc);
+				pango_layout_set_attributes(context.layout, this->attr_list);
+				pango_layout_set_auto_dir(context.layout, this->rtl);
+#endif
+				return context;
+			}
+			static void destroy_context(Context& context) noexcept{
+#ifdef _WIN32
+				SelectObject(context.dc, context.old_font);
+				DeleteDC(context.dc);
+#else
+				g_object_unref(context.layout);
+				cairo_surface_t* surf = cairo_get_target(context.ctx);
+				cairo_destroy(context.ctx);
+				cairo_surface_destroy(surf);
 #endif
+			}
+			Context& context() const{
+				if(!*this)
+					throw exception("Invalid state!");
+				const std::thread::id id = std::this_thread::get_id();
+				std::lock_guard<std::mutex> lock(this->contexts->mutex);
+				const auto it = this->contexts->contexts.find(id);
+				if(it != this->contexts->contexts.end())
+					return it->second;
+				thread_contexts().add(this->contexts);
+				return this->contexts->contexts.emplace(id, this->create_context()).first->second;
+			}
 			// Helpers
+			void release() noexcept{
+				if(this->contexts){
+					std::lock_guard<std::mutex> lock(this->contexts->mutex);
+					for(auto& context : this->contexts->contexts)
+						destroy_context(context.second);
+					this->contexts->contexts.clear();
+				}
+				this->contexts.reset();
+#ifdef _WIN32
+				if(this->font)
+					DeleteObject(this->font);
+#else
+				if(this->font_desc){
+					pango_font_description_free(this->font_desc);
+					pango_attr_list_unref(this->attr_list);
+				}
+#endif
+			}
 			void copy(const Font& other) noexcept{
 #ifdef _WIN32
-				if(!other.dc){
-					this->dc = NULL;
-					this->old_font = NULL;
+				if(!other.font){
+					this->font = NULL;
 					this->spacing = 0;
 				}else{
-					this->dc = CreateCompatibleDC(NULL);
-					SetMapMode(this->dc, GetMapMode(other.dc));
-					SetBkMode(this->dc, GetBkMode(other.dc));
-					SetTextAlign(this->dc, GetTextAlign(other.dc));
 					LOGFONTW lf;	// I trust in Spongebob that it has 4-byte boundary like required by GetObject
-					GetObjectW(GetCurrentObject(other.dc, OBJ_FONT), sizeof(lf), &lf);
-					this->old_font = SelectObject(this->dc, CreateFontIndirectW(&lf));
+					GetObjectW(other.font, sizeof(lf), &lf);
+					this->font = CreateFontIndirectW(&lf);
 					this->spacing = other.spacing;
+					this->contexts = std::make_shared<ContextSet>();
 				}
 #else
-				if(!other.ctx){
-					this->ctx = nullptr;
-					this->layout = nullptr;
+				if(!other.font_desc){
+					this->font_desc = nullptr;
+					this->attr_list = nullptr;
 				}else{
-					this->layout = pango_cairo_create_layout(this->ctx = cairo_create(cairo_image_surface_create(CAIRO_FORMAT_A1, 1, 1)));
-					pango_layout_set_font_description(this->layout, pango_layout_get_font_description(other.layout)),
-					pango_layout_set_attributes(this->layout, pango_layout_get_attributes(other.layout)),
-					pango_layout_set_auto_dir(this->layout, pango_layout_get_auto_dir(other.layout));
+					this->font_desc = pango_font_description_copy(other.font_desc);
+					this->attr_list = pango_attr_list_ref(other.attr_list);	// Never modified after construction
+					this->contexts = std::make_shared<ContextSet>();
 				}
 #endif
+				this->rtl = other.rtl;
 			}
 			void move(Font&& other) noexcept{
 #ifdef _WIN32
-				if(!other.dc){
-					this->dc = NULL;
-					this->old_font = NULL;
-					this->spacing = 0;
-				}else{
-					this->dc = other.dc;
-					other.dc = NULL;
-					this->old_font = other.old_font;
-					other.old_font = NULL;
-					this->spacing = other.spacing;
-					other.spacing = 0;
-				}
+				this->font = other.font;
+				other.font = NULL;
+				this->spacing = other.spacing;
+				other.spacing = 0;
 #else
-				if(!other.ctx){
-					this->ctx = nullptr;
-					this->layout = nullptr;
-				}else{
-					this->ctx = other.ctx;
-					other.ctx = nullptr;
-					this->layout = other.layout;
-					other.layout = nullptr;
-				}
+				this->font_desc = other.font_desc;
+				other.font_desc = nullptr;
+				this->attr_list = other.attr_list;
+				other.attr_list = nullptr;
 #endif
+				this->rtl = other.rtl;
+				other.rtl = false;
+				this->contexts = std::move(other.contexts);
 			}
 		public:
 			// Rule-of-five
 			Font() noexcept :
 #ifdef _WIN32
-				dc(NULL), old_font(NULL), spacing(0)
+				font(NULL), spacing(0),
 #else
-				ctx(nullptr), layout(nullptr)
+				font_desc(nullptr), attr_list(nullptr),
 #endif
+				rtl(false)
 				{}
 			Font(const std::string& family, float size = 12, bool bold = false, bool italic = false, bool underline = false, bool strikeout = false, double spacing = 0.0, bool rtl = false)
 #ifdef _WIN32
 				: Font(Utf8::to_utf16(family), size, bold, italic, underline, strikeout, spacing, rtl){
 #else
-			{
+				: font_desc(nullptr), attr_list(nullptr), rtl(rtl){
 				// Check parameters
 				if(size < 0)
 					throw exception("Size must be bigger zero!");
-				// Create context+layout
-				cairo_surface_t* surf = cairo_image_surface_create(CAIRO_FORMAT_A1, 1, 1);
-				if(!surf)
-					throw exception("Couldn't create cairo surface!");
-				if(!(this->ctx = cairo_create(surf))){
-					cairo_surface_destroy(surf);
-					throw exception("Couldn't create cairo context!");
+				// Set font properties
+				this->font_desc = pango_font_description_new();
+				pango_font_description_set_family(this->font_desc, family.c_str());
+				pango_font_description_set_weight(this->font_desc, bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+				pango_font_description_set_style(this->font_desc, italic ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
+				pango_font_description_set_absolute_size(this->font_desc, size * PANGO_SCALE * FONT_UPSCALE);
+				this->attr_list = pango_attr_list_new();
+				pango_attr_list_insert(this->attr_list, pango_attr_underline_new(underline ? PANGO_UNDERLINE_SINGLE : PANGO_UNDERLINE_NONE));
+				pango_attr_list_insert(this->attr_list, pango_attr_strikethrough_new(strikeout));
+				pango_attr_list_insert(this->attr_list, pango_attr_letter_spacing_new(spacing * PANGO_SCALE * FONT_UPSCALE));
+				// Create context of constructing thread to fail early
+				try{
+					this->contexts = std::make_shared<ContextSet>();
+					this->context();
+				}catch(...){
+					this->release();
+					throw;
 				}
-				if(!(this->layout = pango_cairo_create_layout(this->ctx))){
-					cairo_destroy(this->ctx);
-					cairo_surface_destroy(surf);
-					throw exception("Couldn't create pango layout!");
-				}
-				// Set layout properties
-				PangoFontDescription *font = pango_font_description_new();
-				pango_font_description_set_family(font, family.c_str());
-				pango_font_description_set_weight(font, bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
-				pango_font_description_set_style(font, italic ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
-				pango_font_description_set_absolute_size(font, size * PANGO_SCALE * FONT_UPSCALE);
-				pango_layout_set_font_description(this->layout, font);
-				pango_font_description_free(font);
-				PangoAttrList* attr_list = pango_attr_list_new();
-				pango_attr_list_insert(attr_list, pango_attr_underline_new(underline ? PANGO_UNDERLINE_SINGLE : PANGO_UNDERLINE_NONE));
-				pango_attr_list_insert(attr_list, pango_attr_strikethrough_new(strikeout));
-				pango_attr_list_insert(attr_list, pango_attr_letter_spacing_new(spacing * PANGO_SCALE * FONT_UPSCALE));
-				pango_layout_set_attributes(this->layout, attr_list);
-				pango_attr_list_unref(attr_list);
-				pango_layout_set_auto_dir(this->layout, rtl);
 #endif
 			}
 #ifdef _WIN32
 			Font(const std::wstring& family, float size = 12, bool bold = false, bool italic = false, bool underline = false, bool strikeout = false, double spacing = 0.0, bool rtl = false)
-				: spacing(spacing){
+				: font(NULL), spacing(spacing), rtl(rtl){
 				// Check parameters
 				if(family.length() > 31)	// See LOGFONT limitation
 					throw exception("Family length exceeds 31!");
 				if(size < 0)
 					throw exception("Size must be bigger zero!");
-				// Create context
-				if(!(this->dc = CreateCompatibleDC(NULL)))
-					throw exception("Couldn't create device context!");
-				SetMapMode(this->dc, MM_TEXT);
-				SetBkMode(this->dc, TRANSPARENT);
-				if(rtl)
-					SetTextAlign(this->dc, TA_RTLREADING);
 				// Create font
 				LOGFONTW lf = {0};
 				lf.lfHeight = size * FONT_UPSCALE;
@@ -235,172 +441,162 @@ namespace Font{
 				lf.lfOutPrecision = OUT_TT_PRECIS;
 				lf.lfQuality = ANTIALIASED_QUALITY;
 				lf.lfFaceName[family.copy(lf.lfFaceName, 31)] = L'\0';
-				HFONT font = CreateFontIndirectW(&lf);
-				if(!font){
-					DeleteDC(this->dc);
+				if(!(this->font = CreateFontIndirectW(&lf)))
 					throw exception("Couldn't create font!");
+				// Create context of constructing thread to fail early
+				try{
+					this->contexts = std::make_shared<ContextSet>();
+					this->context();
+				}catch(...){
+					this->release();
+					throw;
 				}
-				// Set font to context
-				this->old_font = SelectObject(this->dc, font);
 			}
 #endif
 			~Font() noexcept{
-#ifdef _WIN32
-				if(this->dc){
-					DeleteObject(SelectObject(this->dc, this->old_font));
-					DeleteDC(this->dc);
-				}
-#else
-				if(this->ctx){
-					g_object_unref(this->layout);
-					cairo_surface_t* surf = cairo_get_target(this->ctx);
-					cairo_destroy(this->ctx);
-					cairo_surface_destroy(surf);
-				}
-#endif
+				this->release();
 			}
 			Font(const Font& other) noexcept{
 				this->copy(other);
 			}
 			Font& operator=(const Font& other) noexcept{
-				this->~Font();
-				this->copy(other);
+				if(this != &other){
+					this->release();
+					this->copy(other);
+					this->clear_cache();
+				}
 				return *this;
 			}
 			Font(Font&& other) noexcept{
 				this->move(std::forward<Font>(other));
 			}
 			Font& operator=(Font&& other) noexcept{
-				this->~Font();
-				this->move(std::forward<Font>(other));
+				if(this != &other){
+					this->release();
+					this->move(std::forward<Font>(other));
+					this->clear_cache();
+				}
 				return *this;
 			}
 			// Getters
 			operator bool() const noexcept{
 #ifdef _WIN32
-				return this->dc;
+				return this->font;
 #else
-				return this->ctx;
+				return this->font_desc;
 #endif
 			}
 			std::string get_family() const{
 #ifdef _WIN32
 				return Utf8::from_utf16(this->get_family_unicode());
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				return pango_font_description_get_family(pango_layout_get_font_description(this->layout));
+				return pango_font_description_get_family(this->font_desc);
 #endif
 			}
 #ifdef _WIN32
 			std::wstring get_family_unicode() const{
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return lf.lfFaceName;
 			}
 #endif
 			float get_size() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return static_cast<float>(lf.lfHeight) / FONT_UPSCALE;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				return static_cast<float>(pango_font_description_get_size(pango_layout_get_font_description(this->layout))) / FONT_UPSCALE / PANGO_SCALE;
+				return static_cast<float>(pango_font_description_get_size(this->font_desc)) / FONT_UPSCALE / PANGO_SCALE;
 #endif
 			}
 			bool get_bold() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return lf.lfWeight == FW_BOLD;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				return pango_font_description_get_weight(pango_layout_get_font_description(this->layout)) == PANGO_WEIGHT_BOLD;
+				return pango_font_description_get_weight(this->font_desc) == PANGO_WEIGHT_BOLD;
 #endif
 			}
 			bool get_italic() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return lf.lfItalic;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				return pango_font_description_get_style(pango_layout_get_font_description(this->layout)) == PANGO_STYLE_ITALIC;
+				return pango_font_description_get_style(this->font_desc) == PANGO_STYLE_ITALIC;
 #endif
 			}
 			bool get_underline() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return lf.lfUnderline;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(pango_layout_get_attributes(this->layout)), pango_attr_iterator_destroy);
+				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(this->attr_list), pango_attr_iterator_destroy);
 				return reinterpret_cast<PangoAttrInt*>(pango_attr_iterator_get(attr_list_iter.get(), PANGO_ATTR_UNDERLINE))->value == PANGO_UNDERLINE_SINGLE;
 #endif
 			}
 			bool get_strikeout() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				LOGFONTW lf;
-				GetObjectW(GetCurrentObject(this->dc, OBJ_FONT), sizeof(lf), &lf);
+				GetObjectW(this->font, sizeof(lf), &lf);
 				return lf.lfStrikeOut;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(pango_layout_get_attributes(this->layout)), pango_attr_iterator_destroy);
+				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(this->attr_list), pango_attr_iterator_destroy);
 				return reinterpret_cast<PangoAttrInt*>(pango_attr_iterator_get(attr_list_iter.get(), PANGO_ATTR_STRIKETHROUGH))->value;
 #endif
 			}
 			double get_spacing() const{
 #ifdef _WIN32
-				if(!this->dc)
+				if(!this->font)
 					throw exception("Invalid state!");
 				return this->spacing;
 #else
-				if(!this->ctx)
+				if(!this->font_desc)
 					throw exception("Invalid state!");
-				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(pango_layout_get_attributes(this->layout)), pango_attr_iterator_destroy);
+				const std::unique_ptr<PangoAttrIterator, void(*)(PangoAttrIterator*)> attr_list_iter(pango_attr_list_get_iterator(this->attr_list), pango_attr_iterator_destroy);
 				return static_cast<double>(reinterpret_cast<PangoAttrInt*>(pango_attr_iterator_get(attr_list_iter.get(), PANGO_ATTR_LETTER_SPACING))->value) / FONT_UPSCALE / PANGO_SCALE;
 #endif
 			}
 			bool get_rtl() const{
-#ifdef _WIN32
-				if(!this->dc)
+				if(!*this)
 					throw exception("Invalid state!");
-				return GetTextAlign(this->dc) == TA_RTLREADING;
-#else
-				if(!this->ctx)
-					throw exception("Invalid state!");
-				return pango_layout_get_auto_dir(this->layout);
-#endif
+				return this->rtl;
 			}
 			// Font/Text informations
 			struct Metrics{
 				double height, ascent, descent, internal_leading, external_leading;
 			};
 			Metrics metrics() const{
+				Context& context = this->context();
 #ifdef _WIN32
-				if(!this->dc)
-					throw exception("Invalid state!");
 				TEXTMETRICW metrics;
-				GetTextMetricsW(this->dc, &metrics);
+				GetTextMetricsW(context.dc, &metrics);
 				return {
 					static_cast<double>(metrics.tmHeight) / FONT_UPSCALE,
 					static_cast<double>(metrics.tmAscent) / FONT_UPSCALE,
@@ -409,61 +605,254 @@ namespace Font{
 					static_cast<double>(metrics.tmExternalLeading) / FONT_UPSCALE
 				};
 #else
-				if(!this->ctx)
-					throw exception("Invalid state!");
 				Metrics result;
-				const std::unique_ptr<PangoFontMetrics, void(*)(PangoFontMetrics*)> metrics(pango_context_get_metrics(pango_layout_get_context(this->layout), pango_layout_get_font_description(this->layout), nullptr), pango_font_metrics_unref);
+				const std::unique_ptr<PangoFontMetrics, void(*)(PangoFontMetrics*)> metrics(pango_context_get_metrics(pango_layout_get_context(context.layout), pango_layout_get_font_description(context.layout), nullptr), pango_font_metrics_unref);
 				result.ascent = static_cast<double>(pango_font_metrics_get_ascent(metrics.get())) / FONT_UPSCALE / PANGO_SCALE;
 				result.descent = static_cast<double>(pango_font_metrics_get_descent(metrics.get())) / FONT_UPSCALE / PANGO_SCALE;
 				result.height = result.ascent + result.descent;
 				result.internal_leading = 0; // HEIGHT - ASCENT - DESCENT
-				result.external_leading = static_cast<double>(pango_layout_get_spacing(this->layout)) / FONT_UPSCALE / PANGO_SCALE;
+				result.external_leading = static_cast<double>(pango_layout_get_spacing(context.layout)) / FONT_UPSCALE / PANGO_SCALE;
 				return result;
 #endif
 			}
 			double text_width(const std::string& text) const{
+				{
+					std::lock_guard<std::mutex> lock(this->cache_mutex);
+					const double* width = this->width_cache.find(text);
+					if(width)
+						return *width;
+				}
 #ifdef _WIN32
-				return this->text_width(Utf8::to_utf16(text));
+				const double width = this->text_width(Utf8::to_utf16(text));
 #else
-				if(!this->ctx)
-					throw exception("Invalid state!");
-				pango_layout_set_text(this->layout, text.data(), text.length());
+				Context& context = this->context();
+				pango_layout_set_text(context.layout, text.data(), text.length());
 				PangoRectangle rect;
-				pango_layout_get_pixel_extents(this->layout, nullptr, &rect);
-				return static_cast<double>(rect.width) / FONT_UPSCALE;
+				pango_layout_get_pixel_extents(context.layout, nullptr, &rect);
+				const double width = static_cast<double>(rect.width) / FONT_UPSCALE;
 #endif
+				std::lock_guard<std::mutex> lock(this->cache_mutex);
+				return this->width_cache.insert(text, width);
 			}
 #ifdef _WIN32
 			double text_width(const std::wstring& text) const{
-				if(!this->dc)
-					throw exception("Invalid state!");
+				Context& context = this->context();
 				SIZE sz;
-				GetTextExtentPoint32W(this->dc, text.data(), text.length(), &sz);
+				GetTextExtentPoint32W(context.dc, text.data(), text.length(), &sz);
 				return static_cast<double>(sz.cx) / FONT_UPSCALE + text.length() * this->spacing;
 			}
 #endif
+			// Glyph clusters with positions from one layout pass (byte range of text, baseline position, advance & ink box)
+			struct Glyph{
+				size_t first, last;	// last is exclusive
+				double x, y, advance;
+				double ink_x, ink_y, ink_width, ink_height;
+			};
+			std::vector<Glyph> glyphs(const std::string& text) const{
+				std::vector<Glyph> result;
+#ifdef _WIN32
+				const std::wstring wtext = Utf8::to_utf16(text);
+				Context& context = this->context();
+				if(wtext.empty())
+					return result;
+				// Cumulated widths per utf-16 unit
+				std::vector<INT> extents(wtext.length());
+				SIZE sz;
+				if(!GetTextExtentExPointW(context.dc, wtext.data(), wtext.length(), 0, NULL, extents.data(), &sz))
+					throw exception("Couldn't get text extents!");
+				TEXTMETRICW metrics;
+				GetTextMetricsW(context.dc, &metrics);
+				// One glyph per code point (surrogate pairs combined)
+				size_t byte = 0;
+				for(size_t i = 0, n = 0; i < wtext.length(); ++n){
+					const bool pair = wtext[i] >= 0xd800 && wtext[i] <= 0xdbff && i+1 < wtext.length();
+					const size_t bytes = pair ? 4 : wtext[i] < 0x80 ? 1 : wtext[i] < 0x800 ? 2 : 3,
+						end = i + (pair ? 2 : 1);
+					const double x = static_cast<double>(i ? extents[i-1] : 0) / FONT_UPSCALE + n * this->spacing,
+						advance = static_cast<double>(extents[end-1] - (i ? extents[i-1] : 0)) / FONT_UPSCALE + this->spacing;
+					result.push_back({
+						byte, byte + bytes,
+						x, static_cast<double>(metrics.tmAscent) / FONT_UPSCALE, advance,
+						x, 0, advance, static_cast<double>(metrics.tmHeight) / FONT_UPSCALE	// Logical box as ink
+					});
+					byte += bytes, i = end;
+				}
+#else
+				Context& context = this->context();
+				pango_layout_set_text(context.layout, text.data(), text.length());
+				const std::unique_ptr<PangoLayoutIter, void(*)(PangoLayoutIter*)> iter(pango_layout_get_iter(context.layout), pango_layout_iter_free);
+				static const double scale = 1.0 / PANGO_SCALE / FONT_UPSCALE;
+				do{
+					const size_t first = pango_layout_iter_get_index(iter.get());
+					if(first >= text.length())	// Line end position
+						continue;
+					PangoRectangle ink, logical;
+					pango_layout_iter_get_cluster_extents(iter.get(), &ink, &logical);
+					result.push_back({
+						first, text.length(),
+						logical.x * scale, pango_layout_iter_get_baseline(iter.get()) * scale, logical.width * scale,
+						ink.x * scale, ink.y * scale, ink.width * scale, ink.height * scale
+					});
+				}while(pango_layout_iter_next_cluster(iter.get()));
+				// Cluster ends by next start in logical order (visual order differs for right-to-left runs)
+				std::vector<size_t> starts;
+				starts.reserve(result.size());
+				for(const Glyph& glyph : result)
+					starts.push_back(glyph.first);
+				std::sort(starts.begin(), starts.end());
+				for(Glyph& glyph : result){
+					const auto next = std::upper_bound(starts.begin(), starts.end(), glyph.first);
+					if(next != starts.end())
+						glyph.last = *next;
+				}
+#endif
+				return result;
+			}
+			// Paragraph layout with line breaking (byte range of text per line, horizontal offset, baseline position & width)
+			enum class Align{LEFT, CENTER, RIGHT, JUSTIFY};
+			enum class Wrap{WORD, CHAR, WORD_CHAR, NONE};
+			struct Line{
+				size_t first, last;	// last is exclusive, line feeds excluded
+				double x, y, width;
+			};
+			std::vector<Line> layout(const std::string& text, const double width = 0, const Align align = Align::LEFT, const Wrap wrap = Wrap::WORD, const double spacing = 0) const{
+				std::vector<Line> result;
+#ifdef _WIN32
+				// Greedy line breaking by measured widths (justification needs Pango, lines stay left-aligned then)
+				const Metrics metrics = this->metrics();
+				const double line_height = metrics.height + metrics.external_leading + spacing;
+				const bool wrapping = width > 0 && wrap != Wrap::NONE;
+				Context& context = this->context();
+				std::vector<INT> extents;	// Cumulated widths of paragraph per utf-16 unit (leading zero)
+				std::vector<size_t> units;	// Utf-16 units of paragraph before byte
+				const auto is_break = [&text](const size_t pos, const bool word){
+					return word ? text[pos-1] == ' ' && text[pos] != ' ' : (text[pos] & 0xc0) != 0x80;
+				};
+				for(size_t paragraph_first = 0;;){
+					const size_t paragraph_last = std::min(text.find('\n', paragraph_first), text.length());
+					// One extents query per paragraph, substring widths by differences
+					const std::string paragraph = text.substr(paragraph_first, paragraph_last - paragraph_first);
+					const std::wstring wparagraph = Utf8::to_utf16(paragraph);
+					extents.assign(wparagraph.length() + 1, 0);
+					SIZE sz;
+					if(!wparagraph.empty() && !GetTextExtentExPointW(context.dc, wparagraph.data(), wparagraph.length(), 0, NULL, extents.data() + 1, &sz))
+						throw exception("Couldn't get text extents!");
+					units.assign(paragraph.length() + 1, 0);
+					for(size_t b = 0, u = 0; b < paragraph.length(); ++b){
+						const unsigned char c = paragraph[b];
+						if((c & 0xc0) != 0x80)
+							u += c >= 0xf0 ? 2 : 1;	// Surrogate pair beyond basic plane
+						units[b+1] = std::min(u, wparagraph.length());
+					}
+					const auto measure = [this,&text,&extents,&units,paragraph_first](const size_t first, size_t last){
+						while(last > first && text[last-1] == ' ')
+							--last;
+						const size_t u0 = units[first - paragraph_first], u1 = units[last - paragraph_first];
+						return static_cast<double>(extents[u1] - extents[u0]) / FONT_UPSCALE + (u1 - u0) * this->spacing;
+					};
+					size_t first = paragraph_first;
+					do{
+						size_t last = paragraph_last;
+						if(wrapping && measure(first, last) > width){
+							// Last break opportunity with fitting line, otherwise first one (overflow)
+							size_t fit = 0, overflow = 0;
+							for(const bool word : {true, false}){
+								if(word ? wrap == Wrap::CHAR : wrap == Wrap::WORD || fit)
+									continue;
+								size_t first_break = 0;
+								for(size_t pos = first + 1; pos < paragraph_last; ++pos)
+									if(is_break(pos, word)){
+										if(!first_break)
+											first_break = pos;
+										if(measure(first, pos) > width)
+											break;
+										fit = pos;
+									}
+								if(first_break)
+									overflow = first_break;
+							}
+							last = fit ? fit : overflow ? overflow : paragraph_last;
+						}
+						result.push_back({first, last, 0, result.size() * line_height + metrics.ascent, measure(first, last)});
+						first = last;
+					}while(first < paragraph_last);
+					if(paragraph_last == text.length())
+						break;
+					paragraph_first = paragraph_last + 1;
+				}
+				// Align lines in layout width (widest line without wrapping)
+				double layout_width = width;
+				if(!wrapping)
+					for(const Line& line : result)
+						layout_width = std::max(layout_width, line.width);
+				if(align == Align::CENTER || align == Align::RIGHT)
+					for(Line& line : result)
+						line.x = (layout_width - line.width) * (align == Align::CENTER ? 0.5 : 1.0);
+#else
+				Context& context = this->context();
+				PangoLayout* layout = context.layout;
+				const bool wrapping = width > 0 && wrap != Wrap::NONE;
+				pango_layout_set_text(layout, text.data(), text.length());
+				pango_layout_set_width(layout, wrapping ? static_cast<int>(width * FONT_UPSCALE * PANGO_SCALE) : -1);
+				pango_layout_set_wrap(layout, wrap == Wrap::CHAR ? PANGO_WRAP_CHAR : wrap == Wrap::WORD_CHAR ? PANGO_WRAP_WORD_CHAR : PANGO_WRAP_WORD);
+				pango_layout_set_alignment(layout, align == Align::CENTER ? PANGO_ALIGN_CENTER : align == Align::RIGHT ? PANGO_ALIGN_RIGHT : PANGO_ALIGN_LEFT);
+				pango_layout_set_justify(layout, align == Align::JUSTIFY);
+				pango_layout_set_spacing(layout, spacing * FONT_UPSCALE * PANGO_SCALE);
+				// Collect lines
+				static const double scale = 1.0 / PANGO_SCALE / FONT_UPSCALE;
+				const std::unique_ptr<PangoLayoutIter, void(*)(PangoLayoutIter*)> iter(pango_layout_get_iter(layout), pango_layout_iter_free);
+				do{
+					const PangoLayoutLine* line = pango_layout_iter_get_line_readonly(iter.get());
+					PangoRectangle logical;
+					pango_layout_iter_get_line_extents(iter.get(), nullptr, &logical);
+					result.push_back({
+						static_cast<size_t>(line->start_index), static_cast<size_t>(line->start_index + line->length),
+						logical.x * scale, pango_layout_iter_get_baseline(iter.get()) * scale, logical.width * scale
+					});
+				}while(pango_layout_iter_next_line(iter.get()));
+				// Unwrapped lines got aligned to widest line, move into requested width
+				if(!wrapping && width > 0 && (align == Align::CENTER || align == Align::RIGHT)){
+					PangoRectangle logical;
+					pango_layout_get_extents(layout, nullptr, &logical);
+					const double offset = (width - logical.width * scale) * (align == Align::CENTER ? 0.5 : 1.0);
+					for(Line& line : result)
+						line.x += offset;
+				}
+				// Reset layout for single line usage
+				pango_layout_set_width(layout, -1);
+				pango_layout_set_wrap(layout, PANGO_WRAP_WORD);
+				pango_layout_set_alignment(layout, PANGO_ALIGN_LEFT);
+				pango_layout_set_justify(layout, false);
+				pango_layout_set_spacing(layout, 0);
+#endif
+				return result;
+			}
 			// Text-to-vectors conversion
 			struct PathSegment{
 				enum class Type{MOVE, LINE, CURVE, CLOSE} type;
 				double x, y;
 			};
 			std::vector<PathSegment> text_path(const std::string& text) const{
+				{
+					std::lock_guard<std::mutex> lock(this->cache_mutex);
+					const std::vector<PathSegment>* path = this->path_cache.find(text);
+					if(path)
+						return *path;
+				}
 #ifdef _WIN32
-				return this->text_path(Utf8::to_utf16(text));
+				std::vector<PathSegment> result = this->text_path(Utf8::to_utf16(text));
 #else
-				// Check valid state/cairo context
-				if(!this->ctx)
-					throw exception("Invalid state!");
+				Context& context = this->context();
 				// Add text path to context
-				pango_layout_set_text(this->layout, text.data(), text.length());
-				cairo_save(this->ctx);
-				cairo_scale(ctx, 1.0 / FONT_UPSCALE, 1.0 / FONT_UPSCALE);
-				pango_cairo_layout_path(this->ctx, this->layout);
-				cairo_restore(this->ctx);
+				pango_layout_set_text(context.layout, text.data(), text.length());
+				cairo_save(context.ctx);
+				cairo_scale(context.ctx, 1.0 / FONT_UPSCALE, 1.0 / FONT_UPSCALE);
+				pango_cairo_layout_path(context.ctx, context.layout);
+				cairo_restore(context.ctx);
 				// Get path points
-				const std::unique_ptr<cairo_path_t, void(*)(cairo_path_t*)> path(cairo_copy_path(this->ctx), cairo_path_destroy);
+				const std::unique_ptr<cairo_path_t, void(*)(cairo_path_t*)> path(cairo_copy_path(context.ctx), cairo_path_destroy);
 				if(path->status != CAIRO_STATUS_SUCCESS){
-					cairo_new_path(this->ctx);
+					cairo_new_path(context.ctx);
 					throw exception("Couldn't get cairo path!");
 				}
 				// Pack points for output
@@ -488,17 +877,59 @@ namespace Font{
 							break;
 					}
 				}
-				// Clear context from path...
-				cairo_new_path(this->ctx);
-				// ...and return collected points
-				return result;
+				// Clear context from path
+				cairo_new_path(context.ctx);
 #endif
+				// Remember & return collected points
+				std::lock_guard<std::mutex> lock(this->cache_mutex);
+				return this->path_cache.insert(text, std::move(result));
+			}
+#ifndef _WIN32
+			// Renders text onto cairo context with its current source, layout top-left at current point
+			void text_draw(cairo_t* target, const std::string& text) const{
+				if(!this->font_desc)
+					throw exception("Invalid state!");
+				const std::unique_ptr<PangoLayout, void(*)(void*)> layout(pango_cairo_create_layout(target), g_object_unref);
+				if(!layout)
+					throw exception("Couldn't create pango layout!");
+				pango_layout_set_font_description(layout.get(), this->font_desc);
+				pango_layout_set_attributes(layout.get(), this->attr_list);
+				pango_layout_set_auto_dir(layout.get(), this->rtl);
+				pango_layout_set_text(layout.get(), text.data(), text.length());
+				double x = 0, y = 0;
+				if(cairo_has_current_point(target))
+					cairo_get_current_point(target, &x, &y);
+				cairo_save(target);
+				cairo_translate(target, x, y);
+				cairo_scale(target, 1.0 / FONT_UPSCALE, 1.0 / FONT_UPSCALE);
+				pango_cairo_update_layout(target, layout.get());
+				cairo_move_to(target, 0, 0);
+				pango_cairo_show_layout(target, layout.get());
+				cairo_restore(target);
+			}
+#endif
+			// Path to closed polygons (curves flattened within tolerance, degenerated contours dropped)
+			static std::vector<std::vector<Geometry::Point2d>> flatten(const std::vector<PathSegment>& path, const double tolerance){
+				Geometry::PathBuilder builder(tolerance);
+				for(size_t i = 0; i < path.size(); ++i){
+					const PathSegment& segment = path[i];
+					switch(segment.type){
+						case PathSegment::Type::MOVE: builder.move(segment.x, segment.y); break;
+						case PathSegment::Type::LINE: builder.line(segment.x, segment.y); break;
+						case PathSegment::Type::CURVE:
+							if(i+2 < path.size()){
+								builder.curve(segment.x, segment.y, path[i+1].x, path[i+1].y, path[i+2].x, path[i+2].y);
+								i += 2;
+							}
+							break;
+						case PathSegment::Type::CLOSE: builder.close(); break;
+					}
+				}
+				return builder.get();
 			}
 #ifdef _WIN32
 			std::vector<PathSegment> text_path(const std::wstring& text) const{
-				// Check valid state/device context
-				if(!this->dc)
-					throw exception("Invalid state!");
+				Context& context = this->context();
 				// Check valid text length
 				if(text.length() > 8192)	// See ExtTextOut limitation
 					throw exception("Text length mustn't exceed 8192!");
@@ -509,24 +940,24 @@ namespace Font{
 					const int scaled_spacing = this->spacing * FONT_UPSCALE;
 					for(const char c : text){
 						INT width;
-						GetCharWidth32W(this->dc, c, c, &width);
+						GetCharWidth32W(context.dc, c, c, &width);
 						xdist.push_back(width + scaled_spacing);
 					}
 				}
 				// Add text path to context
-				BeginPath(this->dc);
-				ExtTextOutW(this->dc, 0, 0, 0x0, NULL, text.data(), text.length(), xdist.empty() ? NULL : xdist.data());
-				EndPath(this->dc);
+				BeginPath(context.dc);
+				ExtTextOutW(context.dc, 0, 0, 0x0, NULL, text.data(), text.length(), xdist.empty() ? NULL : xdist.data());
+				EndPath(context.dc);
 				// Collect path points
 				std::vector<PathSegment> result;
-				const int points_n = GetPath(this->dc, NULL, NULL, 0);
+				const int points_n = GetPath(context.dc, NULL, NULL, 0);
 				if(points_n){
 					std::vector<POINT> points;
 					std::vector<BYTE> types;
 					points.reserve(points_n);
 					types.reserve(points_n);
 					result.reserve(points_n);
-					GetPath(this->dc, points.data(), types.data(), points_n);
+					GetPath(context.dc, points.data(), types.data(), points_n);
 					// Pack points in output
 					for(int point_i = 0; point_i < points_n; ++point_i){
 						switch(types[point_i]){
@@ -547,10 +978,65 @@ namespace Font{
 					}
 				}
 				// Clear context from path...
-				AbortPath(this->dc);
+				AbortPath(context.dc);
 				// ...and return collected points
 				return result;
 			}
 #endif
+			// Cache of text widths & paths (font properties are fixed per instance)
+			struct CacheStats{
+				uint64_t hits, misses;
+				size_t entries, capacity;
+			};
+			CacheStats cache_stats() const{
+				std::lock_guard<std::mutex> lock(this->cache_mutex);
+				return {
+					this->width_cache.get_hits() + this->path_cache.get_hits(),
+					this->width_cache.get_misses() + this->path_cache.get_misses(),
+					this->width_cache.size() + this->path_cache.size(),
+					this->width_cache.get_capacity()
+				};
+			}
+			void set_cache_size(const size_t capacity){
+				std::lock_guard<std::mutex> lock(this->cache_mutex);
+				this->width_cache.set_capacity(capacity);
+				this->path_cache.set_capacity(capacity);
+			}
+			void clear_cache(){
+				std::lock_guard<std::mutex> lock(this->cache_mutex);
+				this->width_cache.clear();
+				this->path_cache.clear();
+			}
+		private:
+			mutable std::mutex cache_mutex;
+			mutable LRU::Cache<std::string, double> width_cache{FONT_CACHE_SIZE};
+			mutable LRU::Cache<std::string, std::vector<PathSegment>> path_cache{FONT_CACHE_SIZE};
 	};
+
+	// Process-wide shared fonts by style (construction once per style, least recently used ones get released over pool size)
+	class Pool{
+		private:
+			typedef std::tuple<std::string, float, bool, bool, bool, bool, double, bool> Key;
+			std::mutex mutex;
+			LRU::Cache<Key, std::shared_ptr<Font>> fonts{FONT_POOL_SIZE};
+		public:
+			std::shared_ptr<Font> get(const std::string& family, float size = 12, bool bold = false, bool italic = false, bool underline = false, bool strikeout = false, double spacing = 0.0, bool rtl = false){
+				const Key key(family, size, bold, italic, underline, strikeout, spacing, rtl);
+				std::lock_guard<std::mutex> lock(this->mutex);
+				std::shared_ptr<Font>* font = this->fonts.find(key);
+				return font ? *font : this->fonts.insert(key, std::make_shared<Font>(family, size, bold, italic, underline, strikeout, spacing, rtl));
+			}
+			size_t size(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				return this->fonts.size();
+			}
+			void clear(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->fonts.clear();
+			}
+	};
+	inline Pool& pool(){
+		static Pool instance;
+		return instance;
+	}
 }
@@ -0,0 +1,304 @@
+/*
+Project: FLuaG
+File: image.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <iterator>
+#include <stdexcept>
+#include <climits>
+
+#ifndef IMAGE_ALIGNMENT
+	#define IMAGE_ALIGNMENT 32	// Fits AVX registers
+#endif
+#ifndef IMAGE_POOL_BUDGET
+	#define IMAGE_POOL_BUDGET (64 << 20)	// Bytes of released canvas memory kept for reuse
+#endif
+
+namespace Image{
+	// Non-owning access to BGR(A) pixel rows in top-down order (negative stride for bottom-up memory)
+	struct View{
+		unsigned char* data;	// First (top) row
+		unsigned width, height;
+		ptrdiff_t stride;
+		bool has_alpha, premultiplied;
+		unsigned channels() const noexcept{return this->has_alpha ? 4 : 3;}
+		unsigned char* row(const unsigned y) const noexcept{return this->data + static_cast<ptrdiff_t>(y) * this->stride;}
+		// Clipped rectangle (may be empty)
+		View sub(int x, int y, int width, int height) const noexcept{
+			if(x < 0) width += x, x = 0;
+			if(y < 0) height += y, y = 0;
+			width = std::max(0, std::min(width, static_cast<int>(this->width) - x));
+			height = std::max(0, std::min(height, static_cast<int>(this->height) - y));
+			return {this->row(y) + x * this->channels(), static_cast<unsigned>(width), static_cast<unsigned>(height), this->stride, this->has_alpha, this->premultiplied};
+		}
+	};
+
+	// Process-wide recycling of released canvas memory by size (recurring canvas dimensions skip allocation)
+	class Pool{
+		public:
+			struct Stats{
+				uint64_t hits, misses;
+				size_t entries, bytes, budget;
+			};
+		private:
+			std::mutex mutex;
+			std::multimap<size_t, std::unique_ptr<unsigned char[]>> blocks;
+			Stats stats = {0, 0, 0, 0, IMAGE_POOL_BUDGET};
+			void trim(){
+				// Largest blocks first
+				while(this->stats.bytes > this->stats.budget && !this->blocks.empty()){
+					const auto it = std::prev(this->blocks.end());
+					this->stats.bytes -= it->first;
+					this->blocks.erase(it);
+				}
+				this->stats.entries = this->blocks.size();
+			}
+		public:
+			std::unique_ptr<unsigned char[]> acquire(const size_t size){
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					const auto it = this->blocks.find(size);
+					if(it != this->blocks.end()){
+						std::unique_ptr<unsigned char[]> memory = std::move(it->second);
+						this->blocks.erase(it);
+						this->stats.bytes -= size;
+						this->stats.entries = this->blocks.size();
+						++this->stats.hits;
+						return memory;
+					}
+					++this->stats.misses;
+				}
+				return std::unique_ptr<unsigned char[]>(new unsigned char[size]);
+			}
+			void release(std::unique_ptr<unsigned char[]> memory, const size_t size){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if(!memory || size > this->stats.budget)
+					return;
+				this->blocks.emplace(size, std::move(memory));
+				this->stats.bytes += size;
+				this->trim();
+			}
+			Stats get_stats(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				return this->stats;
+			}
+			void set_budget(const size_t budget){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stats.budget = budget;
+				this->trim();
+			}
+			void clear(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->blocks.clear();
+				this->stats.bytes = this->stats.entries = 0;
+			}
+	};
+	inline Pool& pool(){
+		static Pool instance;
+		return instance;
+	}
+
+	// Owned BGRA memory with premultiplied alpha and aligned rows
+	class Canvas{
+		private:
+			unsigned width, height;
+			size_t stride;
+			std::unique_ptr<unsigned char[]> memory;
+			unsigned char* aligned_memory;
+			static size_t aligned_stride(const uint64_t width) noexcept{
+				return ((width << 2) + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+			}
+		public:
+			// Dimensions addressable by int coordinates & memory size (no overflow of stride * height)
+			static bool valid_size(const uint64_t width, const uint64_t height) noexcept{
+				return width > 0 && height > 0 && width <= (INT_MAX >> 2) && height <= INT_MAX &&
+					aligned_stride(width) <= (static_cast<uint64_t>(PTRDIFF_MAX) - IMAGE_ALIGNMENT) / height;
+			}
+			// Ctor
+			Canvas(const unsigned width, const unsigned height)
+			: width(width), height(height), stride(valid_size(width, height) ? aligned_stride(width) : throw std::length_error("Invalid canvas size!")),
+			memory(pool().acquire(this->stride * height + IMAGE_ALIGNMENT)){
+				this->aligned_memory = this->memory.get() + (IMAGE_ALIGNMENT - reinterpret_cast<uintptr_t>(this->memory.get()) % IMAGE_ALIGNMENT) % IMAGE_ALIGNMENT;
+				std::fill(this->aligned_memory, this->aligned_memory + this->stride * height, 0);
+			}
+			// Dtor (memory back to pool)
+			~Canvas(){
+				pool().release(std::move(this->memory), this->stride * this->height + IMAGE_ALIGNMENT);
+			}
+			// No copy
+			Canvas(const Canvas&) = delete;
+			Canvas& operator=(const Canvas&) = delete;
+			// Getters
+			unsigned get_width() const noexcept{return this->width;}
+			unsigned get_height() const noexcept{return this->height;}
+			size_t get_stride() const noexcept{return this->stride;}
+			unsigned char* data() noexcept{return this->aligned_memory;}
+			const unsigned char* data() const noexcept{return this->aligned_memory;}
+			View view() noexcept{return {this->aligned_memory, this->width, this->height, static_cast<ptrdiff_t>(this->stride), true, true};}
+	};
+
+	// Owned packed BGR(A) memory
+	class Buffer{
+		private:
+			unsigned width, height;
+			bool has_alpha, premultiplied;
+			std::vector<unsigned char> memory;
+		public:
+			// Ctor
+			Buffer(const unsigned width, const unsigned height, const bool has_alpha, const bool premultiplied = false)
+			: width(width), height(height), has_alpha(has_alpha), premultiplied(premultiplied), memory(static_cast<size_t>(width) * height * (has_alpha ? 4 : 3)){}
+			// Getters
+			unsigned get_width() const noexcept{return this->width;}
+			unsigned get_height() const noexcept{return this->height;}
+			bool get_has_alpha() const noexcept{return this->has_alpha;}
+			size_t size() const noexcept{return this->memory.size();}
+			unsigned char* data() noexcept{return this->memory.data();}
+			const unsigned char* data() const noexcept{return this->memory.data();}
+			View view() noexcept{return {this->memory.data(), this->width, this->height, static_cast<ptrdiff_t>(this->width * (this->has_alpha ? 4 : 3)), this->has_alpha, this->premultiplied};}
+			// Read-only access (view of const buffer mustn't be written)
+			View view() const noexcept{return const_cast<Buffer*>(this)->view();}
+	};
+
+	// Copies pixels between views (top-left aligned, converting channels & alpha premultiplication; no alpha means onto black)
+	inline void copy(const View& src, const View& dst) noexcept{
+		const unsigned width = std::min(src.width, dst.width), height = std::min(src.height, dst.height),
+			src_channels = src.channels(), dst_channels = dst.channels();
+		const bool src_premultiplied = src.premultiplied || !src.has_alpha,
+			dst_premultiplied = dst.premultiplied || !dst.has_alpha;
+		for(unsigned y = 0; y < height; ++y){
+			const unsigned char* src_row = src.row(y);
+			unsigned char* dst_row = dst.row(y);
+			if(src_channels == dst_channels && (src_premultiplied == dst_premultiplied || !src.has_alpha))
+				std::memcpy(dst_row, src_row, width * dst_channels);
+			else
+				for(const unsigned char* const src_row_end = src_row + width * src_channels; src_row != src_row_end; src_row += src_channels, dst_row += dst_channels){
+					const unsigned a = src.has_alpha ? src_row[3] : 255;
+					if(src_premultiplied == dst_premultiplied || a == 255)
+						dst_row[0] = src_row[0], dst_row[1] = src_row[1], dst_row[2] = src_row[2];
+					else if(dst_premultiplied)
+						dst_row[0] = (src_row[0] * a + 127) / 255, dst_row[1] = (src_row[1] * a + 127) / 255, dst_row[2] = (src_row[2] * a + 127) / 255;
+					else if(a)
+						dst_row[0] = std::min(255u, (src_row[0] * 255 + (a >> 1)) / a), dst_row[1] = std::min(255u, (src_row[1] * 255 + (a >> 1)) / a), dst_row[2] = std::min(255u, (src_row[2] * 255 + (a >> 1)) / a);
+					else
+						dst_row[0] = dst_row[1] = dst_row[2] = 0;
+					if(dst_channels == 4)
+						dst_row[3] = a;
+				}
+		}
+	}
+
+	// Alpha premultiplication of BGRA pixels
+	inline void premultiply(unsigned char* data, const size_t pixels) noexcept{
+		for(unsigned char* const data_end = data + (pixels << 2); data != data_end; data += 4){
+			const unsigned a = data[3];
+			data[0] = (data[0] * a + 127) / 255;
+			data[1] = (data[1] * a + 127) / 255;
+			data[2] = (data[2] * a + 127) / 255;
+		}
+	}
+	inline void unpremultiply(unsigned char* data, const size_t pixels) noexcept{
+		for(unsigned char* const data_end = data + (pixels << 2); data != data_end; data += 4){
+			const unsigned a = data[3];
+			if(a && a != 255){
+				data[0] = std::min(255u, (data[0] * 255 + (a >> 1)) / a);
+				data[1] = std::min(255u, (data[1] * 255 + (a >> 1)) / a);
+				data[2] = std::min(255u, (data[2] * 255 + (a >> 1)) / a);
+			}
+		}
+	}
+
+	// Blending of premultiplied colors (source onto destination)
+	enum class Blend{NORMAL, ADD, MULTIPLY, SCREEN, MASK};
+	inline unsigned div255(const unsigned x) noexcept{
+		return (x + 128 + ((x + 128) >> 8)) >> 8;
+	}
+	// Blends premultiplied BGRA pixels with opacity in [0,255] (branch-free for vectorization)
+	template<Blend mode>
+	inline void blend_row(const unsigned char* src, unsigned char* dst, const unsigned width, const unsigned opacity) noexcept{
+		for(unsigned x = 0; x < width; ++x, src += 4, dst += 4){
+			unsigned s[4], d[4];
+			for(int c = 0; c < 4; ++c)
+				s[c] = div255(src[c] * opacity), d[c] = dst[c];
+			const unsigned sa = s[3], da = d[3];
+			switch(mode){
+				case Blend::NORMAL:
+					for(int c = 0; c < 4; ++c)
+						d[c] = s[c] + div255(d[c] * (255 - sa));
+					break;
+				case Blend::ADD:
+					for(int c = 0; c < 4; ++c)
+						d[c] = std::min(255u, s[c] + d[c]);
+					break;
+				case Blend::MULTIPLY:
+					for(int c = 0; c < 3; ++c)
+						d[c] = div255(s[c] * d[c] + s[c] * (255 - da) + d[c] * (255 - sa));
+					d[3] = sa + da - div255(sa * da);
+					break;
+				case Blend::SCREEN:
+					for(int c = 0; c < 4; ++c)
+						d[c] = s[c] + d[c] - div255(s[c] * d[c]);
+					break;
+				case Blend::MASK:	// Destination kept by source alpha
+					for(int c = 0; c < 4; ++c)
+						d[c] = div255(d[c] * sa);
+					break;
+			}
+			for(int c = 0; c < 4; ++c)
+				dst[c] = d[c];
+		}
+	}
+	template<Blend mode>
+	inline void composite_rows(const View& src, const View& dst, const unsigned opacity){
+		// Premultiplied BGRA on both sides blends in place
+		if(src.has_alpha && src.premultiplied && dst.has_alpha && dst.premultiplied){
+			for(unsigned y = 0; y < dst.height; ++y)
+				blend_row<mode>(src.row(y), dst.row(y), dst.width, opacity);
+			return;
+		}
+		// Other formats converted per row (no alpha means opaque)
+		std::vector<unsigned char> src_line(static_cast<size_t>(dst.width) << 2), dst_line(src_line.size());
+		const View src_line_view{src_line.data(), dst.width, 1, 0, true, true},
+			dst_line_view{dst_line.data(), dst.width, 1, 0, true, true};
+		for(unsigned y = 0; y < dst.height; ++y){
+			const View src_row = src.sub(0, y, dst.width, 1), dst_row = dst.sub(0, y, dst.width, 1);
+			copy(src_row, src_line_view);
+			copy(dst_row, dst_line_view);
+			blend_row<mode>(src_line.data(), dst_line.data(), dst.width, opacity);
+			copy(dst_line_view, dst_row);
+		}
+	}
+	// Composites source at position of destination (clipped) with opacity in [0,1]
+	inline void composite(const View& src, const View& dst, const int x, const int y, const double opacity = 1, const Blend mode = Blend::NORMAL){
+		const View dst_area = dst.sub(x, y, src.width, src.height),
+			src_area = src.sub(x < 0 ? -x : 0, y < 0 ? -y : 0, dst_area.width, dst_area.height);
+		const unsigned alpha = std::max(0.0, std::min(255.0, opacity * 255 + 0.5));
+		if(!src_area.width || !src_area.height || (!alpha && mode != Blend::MASK))
+			return;
+		switch(mode){
+			case Blend::NORMAL: composite_rows<Blend::NORMAL>(src_area, dst_area, alpha); break;
+			case Blend::ADD: composite_rows<Blend::ADD>(src_area, dst_area, alpha); break;
+			case Blend::MULTIPLY: composite_rows<Blend::MULTIPLY>(src_area, dst_area, alpha); break;
+			case Blend::SCREEN: composite_rows<Blend::SCREEN>(src_area, dst_area, alpha); break;
+			case Blend::MASK: composite_rows<Blend::MASK>(src_area, dst_area, alpha); break;
+		}
+	}
+}
@@ -16,17 +16,18 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #include <memory>
 #include <algorithm>
+#include <cstddef>
 
 namespace ImageOp{
 	// Copy data rows with different strides and optional vertical flipping
 	inline void copy(const unsigned char* src_data, unsigned char* dst_data, const unsigned height, const unsigned src_stride, const unsigned dst_stride, const bool flip = false){
 		if(!flip && src_stride == dst_stride)
-			std::copy(src_data, src_data + height * src_stride, dst_data);
+			std::copy(src_data, src_data + static_cast<size_t>(height) * src_stride, dst_data);
 		else{
-			if(flip) src_data += (height-1) * src_stride;
-			const int src_stride_i = flip ? -src_stride : src_stride;
+			if(flip) src_data += static_cast<size_t>(height-1) * src_stride;
+			const ptrdiff_t src_stride_i = flip ? -static_cast<ptrdiff_t>(src_stride) : static_cast<ptrdiff_t>(src_stride);
 			const unsigned min_stride = std::min(src_stride, dst_stride);
-			for(const unsigned char* const dst_data_end = dst_data + height * dst_stride; dst_data != dst_data_end; src_data += src_stride_i, dst_data += dst_stride)
+			for(const unsigned char* const dst_data_end = dst_data + static_cast<size_t>(height) * dst_stride; dst_data != dst_data_end; src_data += src_stride_i, dst_data += dst_stride)
 				std::copy(src_data, src_data + min_stride, dst_data);
 		}
 	}
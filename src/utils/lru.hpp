@@ -0,0 +1,81 @@
+/*
+Project: FLuaG
+File: lru.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+namespace LRU{
+	// Key-value store dropping least recently used entries over capacity (at least one; not synchronized)
+	template<typename Key, typename Value>
+	class Cache{
+		private:
+			// Most recently used first
+			typedef std::list<std::pair<Key, Value>> Entries;
+			Entries entries;
+			std::map<Key, typename Entries::iterator> index;
+			size_t capacity;
+			// Statistics
+			uint64_t hits = 0, misses = 0;
+			void trim(){
+				while(this->entries.size() > this->capacity){
+					this->index.erase(this->entries.back().first);
+					this->entries.pop_back();
+				}
+			}
+		public:
+			// Ctor
+			Cache(const size_t capacity) : capacity(std::max(capacity, static_cast<size_t>(1))){}
+			// Lookup (NULL on miss), counts for statistics
+			Value* find(const Key& key){
+				const auto it = this->index.find(key);
+				if(it == this->index.end()){
+					++this->misses;
+					return nullptr;
+				}
+				++this->hits;
+				this->entries.splice(this->entries.begin(), this->entries, it->second);
+				return &it->second->second;
+			}
+			// Insert or replace, returns stored value
+			Value& insert(const Key& key, Value value){
+				const auto it = this->index.find(key);
+				if(it != this->index.end()){
+					this->entries.splice(this->entries.begin(), this->entries, it->second);
+					return it->second->second = std::move(value);
+				}
+				this->entries.emplace_front(key, std::move(value));
+				this->index[key] = this->entries.begin();
+				this->trim();
+				return this->entries.front().second;
+			}
+			void clear(){
+				this->entries.clear();
+				this->index.clear();
+			}
+			// Getters & setters
+			size_t size() const noexcept{return this->entries.size();}
+			size_t get_capacity() const noexcept{return this->capacity;}
+			void set_capacity(const size_t capacity){
+				this->capacity = std::max(capacity, static_cast<size_t>(1));
+				this->trim();
+			}
+			uint64_t get_hits() const noexcept{return this->hits;}
+			uint64_t get_misses() const noexcept{return this->misses;}
+	};
+}
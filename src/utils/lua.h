@@ -29,6 +29,26 @@ Permission is granted to anyone to use this software for any purpose, including
 		}
 	}
 	#define luaL_newlib(L, l) (luaL_newlibtable(L,l), luaL_setfuncs(L,l,0))
+	inline void* luaL_testudata(lua_State* L, int arg, const char* tname) noexcept{
+		void* p = lua_touserdata(L, arg);
+		if(p && lua_getmetatable(L, arg)){
+			luaL_getmetatable(L, tname);
+			if(!lua_rawequal(L, -1, -2))
+				p = NULL;
+			lua_pop(L, 2);
+			return p;
+		}
+		return NULL;
+	}
+	#define lua_absindex(L, idx) ((idx) > 0 || (idx) <= LUA_REGISTRYINDEX ? (idx) : lua_gettop(L) + (idx) + 1)
+	inline lua_Number lua_tonumberx(lua_State* L, int idx, int* isnum) noexcept{
+		if(isnum)
+			*isnum = lua_isnumber(L, idx);
+		return lua_tonumber(L, idx);
+	}
+	// Userdata environment as uservalue (tables only)
+	#define lua_getuservalue lua_getfenv
+	#define lua_setuservalue(L, idx) static_cast<void>(lua_setfenv(L, idx))
 #else
 	#define lua_equal(L, i1, i2) lua_compare(L, i1, i2, LUA_OPEQ)
 #endif
@@ -19,6 +19,7 @@ Permission is granted to anyone to use this software for any purpose, including
 #include <array>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
 
 // Useful math defines (not standard)
 #define M_PI		3.14159265358979323846
@@ -185,6 +186,64 @@ namespace Geometry{
 		return lines;
 	}
 
+	// Receiver of path commands (move, line, cubic bezier, close)
+	class PathSink{
+		public:
+			virtual ~PathSink() = default;
+			virtual void move(const double x, const double y) = 0;
+			virtual void line(const double x, const double y) = 0;
+			virtual void curve(const double x1, const double y1, const double x2, const double y2, const double x3, const double y3) = 0;
+			virtual void close() = 0;
+	};
+
+	// Closed polygons from path commands (curves flattened within tolerance, drawing after close continues from contour start)
+	class PathBuilder : public PathSink{
+		private:
+			std::vector<std::vector<Point2d>> contours;
+			const double tolerance;
+			std::vector<Point2d>& current(){
+				if(this->contours.empty())
+					this->contours.push_back({{0, 0}});
+				return this->contours.back();
+			}
+		public:
+			PathBuilder(const double tolerance = 0.1) : tolerance(tolerance){
+				if(!(tolerance > 0))
+					throw std::invalid_argument("Invalid tolerance!");
+			}
+			void move(const double x, const double y) override{
+				if(!this->contours.empty() && this->contours.back().size() == 1)
+					this->contours.back().front() = {x, y};
+				else
+					this->contours.push_back({{x, y}});
+			}
+			void line(const double x, const double y) override{
+				this->current().push_back({x, y});
+			}
+			void curve(const double x1, const double y1, const double x2, const double y2, const double x3, const double y3) override{
+				std::vector<Point2d>& contour = this->current();
+				const std::vector<Point2d> points = curve_flatten({{contour.back(), {x1, y1}, {x2, y2}, {x3, y3}}}, this->tolerance);
+				contour.insert(contour.end(), points.begin()+1, points.end());
+			}
+			void close() override{
+				if(!this->contours.empty())
+					this->move(this->contours.back().front().x, this->contours.back().front().y);
+			}
+			// Contours with area (without closing duplicate), moved by offset
+			std::vector<std::vector<Point2d>> get(const double dx = 0, const double dy = 0) const{
+				std::vector<std::vector<Point2d>> result;
+				for(const std::vector<Point2d>& contour : this->contours){
+					const size_t n = contour.size() > 1 && contour.front() == contour.back() ? contour.size() - 1 : contour.size();
+					if(n > 2){
+						result.emplace_back(contour.begin(), contour.begin() + n);
+						for(Point2d& p : result.back())
+							p.x += dx, p.y += dy;
+					}
+				}
+				return result;
+			}
+	};
+
 	// 4D
 	template<typename T>
 	class Matrix4x4 : public std::array<T,16>{
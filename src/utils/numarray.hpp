@@ -0,0 +1,250 @@
+/*
+Project: FLuaG
+File: numarray.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef NUMARRAY_ALIGNMENT
+	#define NUMARRAY_ALIGNMENT 32	// Fits AVX registers
+#endif
+
+namespace NumArray{
+	// Element types
+	enum class Type{FLOAT32, FLOAT64, INT32};
+	inline size_t type_size(const Type type) noexcept{
+		return type == Type::FLOAT64 ? sizeof(double) : (type == Type::FLOAT32 ? sizeof(float) : sizeof(int32_t));
+	}
+
+	// Element-wise operations
+	enum class Op{ADD, SUB, MUL, DIV};
+
+	// Kernels (simple loops over contiguous memory; element-wise ones vectorized by compiler, floating point min/max stays scalar without fast-math)
+	template<typename D, typename S>
+	inline void apply(const Op op, D* dst, const S* src, const size_t n) noexcept{
+		switch(op){
+			case Op::ADD: for(size_t i = 0; i < n; ++i) dst[i] += src[i]; break;
+			case Op::SUB: for(size_t i = 0; i < n; ++i) dst[i] -= src[i]; break;
+			case Op::MUL: for(size_t i = 0; i < n; ++i) dst[i] *= src[i]; break;
+			case Op::DIV: for(size_t i = 0; i < n; ++i) dst[i] /= src[i]; break;
+		}
+	}
+	template<typename D>
+	inline void apply_scalar(const Op op, D* dst, const D value, const size_t n) noexcept{
+		switch(op){
+			case Op::ADD: for(size_t i = 0; i < n; ++i) dst[i] += value; break;
+			case Op::SUB: for(size_t i = 0; i < n; ++i) dst[i] -= value; break;
+			case Op::MUL: for(size_t i = 0; i < n; ++i) dst[i] *= value; break;
+			case Op::DIV: for(size_t i = 0; i < n; ++i) dst[i] /= value; break;
+		}
+	}
+	template<typename T>
+	inline double sum(const T* data, const size_t n) noexcept{
+		// Independent accumulators break the dependency chain (no reordering of floating point additions allowed to compiler)
+		double acc[4] = {0, 0, 0, 0};
+		size_t i = 0;
+		for(const size_t n4 = n & ~static_cast<size_t>(0x3); i < n4; i += 4)
+			acc[0] += data[i], acc[1] += data[i+1], acc[2] += data[i+2], acc[3] += data[i+3];
+		for(; i < n; ++i)
+			acc[0] += data[i];
+		return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+	}
+	template<typename T>
+	inline std::pair<T,T> minmax(const T* data, const size_t n) noexcept{
+		T min_v = n ? data[0] : 0, max_v = min_v;
+		for(size_t i = 1; i < n; ++i){
+			min_v = data[i] < min_v ? data[i] : min_v;
+			max_v = data[i] > max_v ? data[i] : max_v;
+		}
+		return {min_v, max_v};
+	}
+	template<typename D, typename S>
+	inline void convert(D* dst, const S* src, const size_t n) noexcept{
+		for(size_t i = 0; i < n; ++i)
+			dst[i] = static_cast<D>(src[i]);
+	}
+
+	// Integer of real number (truncated toward zero, saturated to range, NaN as zero)
+	inline int32_t to_int32(const double x) noexcept{
+		return x >= INT32_MAX ? INT32_MAX : x <= INT32_MIN ? INT32_MIN : x == x ? static_cast<int32_t>(x) : 0;
+	}
+	// Integer destinations compute in double and saturate (no overflow, INT32_MIN / -1 gives INT32_MAX, real operands keep fractions)
+	inline double apply_op(const Op op, const double a, const double b) noexcept{
+		switch(op){
+			case Op::ADD: return a + b;
+			case Op::SUB: return a - b;
+			case Op::MUL: return a * b;
+			case Op::DIV: return a / b;
+		}
+		return a;
+	}
+	template<typename S>
+	inline void apply(const Op op, int32_t* dst, const S* src, const size_t n) noexcept{
+		for(size_t i = 0; i < n; ++i)
+			dst[i] = to_int32(apply_op(op, dst[i], src[i]));
+	}
+	inline void apply_scalar(const Op op, int32_t* dst, const double value, const size_t n) noexcept{
+		for(size_t i = 0; i < n; ++i)
+			dst[i] = to_int32(apply_op(op, dst[i], value));
+	}
+	template<typename S>
+	inline void convert(int32_t* dst, const S* src, const size_t n) noexcept{
+		for(size_t i = 0; i < n; ++i)
+			dst[i] = to_int32(src[i]);
+	}
+
+	// Contiguous & aligned numbers storage
+	class Array{
+		private:
+			Type type;
+			size_t n;
+			std::unique_ptr<unsigned char[]> memory;
+			void* aligned_memory;
+			void allocate(){
+				this->memory.reset(new unsigned char[this->n * type_size(this->type) + NUMARRAY_ALIGNMENT]);
+				this->aligned_memory = this->memory.get() + (NUMARRAY_ALIGNMENT - reinterpret_cast<uintptr_t>(this->memory.get()) % NUMARRAY_ALIGNMENT) % NUMARRAY_ALIGNMENT;
+			}
+		public:
+			// Ctors
+			Array(const Type type, const size_t n) : type(type), n(n){
+				this->allocate();
+				std::fill(static_cast<unsigned char*>(this->aligned_memory), static_cast<unsigned char*>(this->aligned_memory) + this->bytes(), 0);
+			}
+			Array(const Array& other) : type(other.type), n(other.n){
+				this->allocate();
+				std::copy(static_cast<const unsigned char*>(other.aligned_memory), static_cast<const unsigned char*>(other.aligned_memory) + other.bytes(), static_cast<unsigned char*>(this->aligned_memory));
+			}
+			Array& operator=(const Array&) = delete;
+			// Getters
+			Type get_type() const noexcept{return this->type;}
+			size_t size() const noexcept{return this->n;}
+			size_t bytes() const noexcept{return this->n * type_size(this->type);}
+			void* data() noexcept{return this->aligned_memory;}
+			const void* data() const noexcept{return this->aligned_memory;}
+			template<typename T>
+			T* data() noexcept{return static_cast<T*>(this->aligned_memory);}
+			template<typename T>
+			const T* data() const noexcept{return static_cast<const T*>(this->aligned_memory);}
+			// Single element access
+			double get(const size_t i) const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: return this->data<float>()[i];
+					case Type::FLOAT64: return this->data<double>()[i];
+					case Type::INT32: return this->data<int32_t>()[i];
+				}
+				return 0;
+			}
+			void set(const size_t i, const double value) noexcept{
+				switch(this->type){
+					case Type::FLOAT32: this->data<float>()[i] = value; break;
+					case Type::FLOAT64: this->data<double>()[i] = value; break;
+					case Type::INT32: this->data<int32_t>()[i] = to_int32(value); break;
+				}
+			}
+			// Range conversion into foreign memory
+			template<typename T>
+			void copy_to(T* dst, const size_t first, const size_t count) const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: convert(dst, this->data<float>() + first, count); break;
+					case Type::FLOAT64: convert(dst, this->data<double>() + first, count); break;
+					case Type::INT32: convert(dst, this->data<int32_t>() + first, count); break;
+				}
+			}
+			// Range copy between arrays (with type conversion)
+			void copy(const Array& src, const size_t src_first, const size_t count, const size_t dst_first){
+				if(src_first + count > src.n || dst_first + count > this->n)
+					throw std::out_of_range("Range exceeds array!");
+				if(&src == this){	// Overlapping ranges possible
+					const size_t esize = type_size(this->type);
+					std::memmove(static_cast<unsigned char*>(this->aligned_memory) + dst_first * esize, static_cast<const unsigned char*>(src.aligned_memory) + src_first * esize, count * esize);
+					return;
+				}
+				switch(this->type){
+					case Type::FLOAT32: src.copy_to(this->data<float>() + dst_first, src_first, count); break;
+					case Type::FLOAT64: src.copy_to(this->data<double>() + dst_first, src_first, count); break;
+					case Type::INT32: src.copy_to(this->data<int32_t>() + dst_first, src_first, count); break;
+				}
+			}
+			// Range fill
+			void fill(const double value, const size_t first, const size_t count){
+				if(first + count > this->n)
+					throw std::out_of_range("Range exceeds array!");
+				switch(this->type){
+					case Type::FLOAT32: std::fill_n(this->data<float>() + first, count, static_cast<float>(value)); break;
+					case Type::FLOAT64: std::fill_n(this->data<double>() + first, count, value); break;
+					case Type::INT32: std::fill_n(this->data<int32_t>() + first, count, to_int32(value)); break;
+				}
+			}
+			// Element-wise arithmetic
+			void apply(const Op op, const double value){
+				switch(this->type){
+					case Type::FLOAT32: NumArray::apply_scalar(op, this->data<float>(), static_cast<float>(value), this->n); break;
+					case Type::FLOAT64: NumArray::apply_scalar(op, this->data<double>(), value, this->n); break;
+					case Type::INT32:
+						if(op == Op::DIV && value == 0)
+							throw std::domain_error("Integer division by zero!");
+						NumArray::apply_scalar(op, this->data<int32_t>(), value, this->n);
+						break;
+				}
+			}
+			void apply(const Op op, const Array& other){
+				if(this->n != other.n)
+					throw std::length_error("Array sizes differ!");
+				if(this->type == Type::INT32 && op == Op::DIV && other.has_zero())
+					throw std::domain_error("Integer division by zero!");
+				switch(this->type){
+					case Type::FLOAT32: other.apply_to(op, this->data<float>()); break;
+					case Type::FLOAT64: other.apply_to(op, this->data<double>()); break;
+					case Type::INT32: other.apply_to(op, this->data<int32_t>()); break;
+				}
+			}
+			template<typename D>
+			void apply_to(const Op op, D* dst) const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: NumArray::apply(op, dst, this->data<float>(), this->n); break;
+					case Type::FLOAT64: NumArray::apply(op, dst, this->data<double>(), this->n); break;
+					case Type::INT32: NumArray::apply(op, dst, this->data<int32_t>(), this->n); break;
+				}
+			}
+			// Reductions
+			double sum() const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: return NumArray::sum(this->data<float>(), this->n);
+					case Type::FLOAT64: return NumArray::sum(this->data<double>(), this->n);
+					case Type::INT32: return NumArray::sum(this->data<int32_t>(), this->n);
+				}
+				return 0;
+			}
+			std::pair<double,double> minmax() const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: return NumArray::minmax(this->data<float>(), this->n);
+					case Type::FLOAT64: return NumArray::minmax(this->data<double>(), this->n);
+					case Type::INT32: return NumArray::minmax(this->data<int32_t>(), this->n);
+				}
+				return {0, 0};
+			}
+			bool has_zero() const noexcept{
+				switch(this->type){
+					case Type::FLOAT32: return std::find(this->data<float>(), this->data<float>() + this->n, 0.0f) != this->data<float>() + this->n;
+					case Type::FLOAT64: return std::find(this->data<double>(), this->data<double>() + this->n, 0.0) != this->data<double>() + this->n;
+					case Type::INT32: return std::find(this->data<int32_t>(), this->data<int32_t>() + this->n, 0) != this->data<int32_t>() + this->n;
+				}
+				return false;
+			}
+	};
+}
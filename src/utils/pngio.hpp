@@ -0,0 +1,531 @@
+/*
+Project: FLuaG
+File: pngio.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <png.h>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <string>
+#include <map>
+#include <list>
+#include <mutex>
+#include <ctime>
+#include <tuple>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <ostream>
+#include <fstream>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "image.hpp"
+#include "threading.hpp"
+
+namespace PNG{
+	// Decodes PNG from memory into image views (no Lua, usable by worker threads)
+	class Decoder{
+		private:
+			// Source memory
+			const unsigned char* data, *const data_end;
+			// PNG structures
+			png_structp png = nullptr;
+			png_infop info = nullptr;
+			// Header (after expansion to 8-bit RGB(A))
+			unsigned width, height;
+			bool has_alpha;
+			// Row conversions
+			static void convert_row(const unsigned char* src, const unsigned src_channels, unsigned char* dst, const unsigned dst_channels, const unsigned n, const bool premultiply) noexcept{
+				if(src_channels == 4){
+					if(dst_channels == 4){
+						if(premultiply)
+							for(const unsigned char* const src_end = src + (n << 2); src != src_end; src += 4, dst += 4){
+								const unsigned a = src[3];
+								dst[0] = (src[0] * a + 127) / 255, dst[1] = (src[1] * a + 127) / 255, dst[2] = (src[2] * a + 127) / 255, dst[3] = a;
+							}
+						else
+							std::copy(src, src + (n << 2), dst);
+					}else{
+						if(premultiply)	// Onto black
+							for(const unsigned char* const src_end = src + (n << 2); src != src_end; src += 4, dst += 3){
+								const unsigned a = src[3];
+								dst[0] = (src[0] * a + 127) / 255, dst[1] = (src[1] * a + 127) / 255, dst[2] = (src[2] * a + 127) / 255;
+							}
+						else
+							for(const unsigned char* const src_end = src + (n << 2); src != src_end; src += 4, dst += 3)
+								dst[0] = src[0], dst[1] = src[1], dst[2] = src[2];
+					}
+				}else{
+					if(dst_channels == 4)
+						for(const unsigned char* const src_end = src + n * 3; src != src_end; src += 3, dst += 4)
+							dst[0] = src[0], dst[1] = src[1], dst[2] = src[2], dst[3] = 255;
+					else
+						std::copy(src, src + n * 3, dst);
+				}
+			}
+			// Box downscale: alpha-weighted color sums per output pixel
+			static void accumulate_row(const unsigned char* src, const unsigned channels, const unsigned width, const unsigned scale, uint32_t* sums) noexcept{
+				for(unsigned x = 0; x < width; ++x, src += channels){
+					uint32_t* sum = sums + (x / scale) * channels;
+					if(channels == 4){
+						const unsigned a = src[3];
+						sum[0] += src[0] * a, sum[1] += src[1] * a, sum[2] += src[2] * a, sum[3] += a;
+					}else
+						sum[0] += src[0], sum[1] += src[1], sum[2] += src[2];
+				}
+			}
+			static void average_row(const uint32_t* sums, const unsigned channels, const unsigned width, const unsigned scale, const unsigned rows, unsigned char* dst, const unsigned dst_width) noexcept{
+				for(unsigned x = 0; x < dst_width; ++x, sums += channels, dst += channels){
+					const unsigned count = rows * std::min(scale, width - x * scale);
+					if(channels == 4){
+						const uint32_t a = sums[3];
+						if(a)
+							dst[0] = (sums[0] + (a >> 1)) / a, dst[1] = (sums[1] + (a >> 1)) / a, dst[2] = (sums[2] + (a >> 1)) / a;
+						else
+							dst[0] = dst[1] = dst[2] = 0;
+						dst[3] = (a + (count >> 1)) / count;
+					}else
+						dst[0] = (sums[0] + (count >> 1)) / count, dst[1] = (sums[1] + (count >> 1)) / count, dst[2] = (sums[2] + (count >> 1)) / count;
+				}
+			}
+		public:
+			// Ctor (reads header)
+			Decoder(const unsigned char* data, const size_t len) : data(data), data_end(data + len){
+				static const unsigned PNG_SIG_BYTES = 8;
+				if(len < PNG_SIG_BYTES || png_sig_cmp(const_cast<png_bytep>(data), 0, PNG_SIG_BYTES))
+					throw std::invalid_argument("File signature isn't PNG!");
+				if(!(this->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, [](png_structp png, png_const_charp){png_longjmp(png, 1);}, [](png_structp, png_const_charp){})) || !(this->info = png_create_info_struct(this->png))){
+					png_destroy_read_struct(&this->png, &this->info, nullptr);
+					throw std::runtime_error("Couldn't create PNG structures!");
+				}
+				if(setjmp(png_jmpbuf(this->png))){
+					png_destroy_read_struct(&this->png, &this->info, nullptr);
+					throw std::runtime_error("Couldn't read PNG header!");
+				}
+				png_set_read_fn(this->png, this, [](png_structp png, png_bytep out, png_size_t out_size){
+					Decoder* decoder = static_cast<Decoder*>(png_get_io_ptr(png));
+					if(static_cast<size_t>(decoder->data_end - decoder->data) < out_size)
+						png_error(png, "Unexpected end of data!");
+					std::copy(decoder->data, decoder->data + out_size, out);
+					decoder->data += out_size;
+				});
+				png_read_info(this->png, this->info);
+				int color_type;
+				png_uint_32 width, height;
+				png_get_IHDR(this->png, this->info, &width, &height, nullptr, &color_type, nullptr, nullptr, nullptr);
+				this->width = width, this->height = height;
+				this->has_alpha = color_type & PNG_COLOR_MASK_ALPHA || png_get_valid(this->png, this->info, PNG_INFO_tRNS);
+			}
+			// No copy
+			Decoder(const Decoder&) = delete;
+			Decoder& operator=(const Decoder&) = delete;
+			// Dtor
+			~Decoder(){
+				png_destroy_read_struct(&this->png, &this->info, nullptr);
+			}
+			// Getters
+			unsigned get_width() const noexcept{return this->width;}
+			unsigned get_height() const noexcept{return this->height;}
+			bool get_has_alpha() const noexcept{return this->has_alpha;}
+			static unsigned scaled(const unsigned size, const unsigned scale) noexcept{return (size + scale - 1) / scale;}
+			// Decode image (once) downscaled by integer factor into target at position (clipped)
+			void decode(const Image::View& target, const int x, const int y, const unsigned scale = 1, const bool premultiply = false, const bool bgr = true){
+				// Buffers before jump point (no leaks on errors)
+				std::vector<unsigned char> image, row, scaled_row;
+				std::vector<uint32_t> sums;
+				std::vector<png_bytep> image_rows;
+				if(setjmp(png_jmpbuf(this->png)))
+					throw std::runtime_error("PNG read error occured!");
+				// Image transformations
+				png_set_expand(this->png);		// Converts PALETTE->RGB24, GREY?->GREY8, RNG_CHUNK->ALPHA
+				png_set_strip_16(this->png);		// Converts RGB48->RGB24, GREY16->GREY8
+				png_set_gray_to_rgb(this->png);		// Converts GREY->RGB
+				if(bgr)
+					png_set_bgr(this->png);		// Converts RGB->BGR
+				const int passes = png_set_interlace_handling(this->png);
+				png_read_update_info(this->png, this->info);
+				// Target region
+				const unsigned channels = this->has_alpha ? 4 : 3,
+					rowbytes = this->width * channels,
+					out_width = scaled(this->width, scale), out_height = scaled(this->height, scale),
+					skip_x = x < 0 ? -x : 0, skip_y = y < 0 ? -y : 0;
+				const Image::View dst = target.sub(x, y, out_width, out_height);
+				if(dst.width == 0 || dst.height == 0)
+					return;
+				row.resize(rowbytes);
+				// Direct row reading into target
+				if(scale == 1 && channels == dst.channels() && !(premultiply && this->has_alpha) && skip_x == 0 && dst.width == this->width && passes == 1){
+					for(unsigned r = 0; r < skip_y + dst.height; ++r)
+						png_read_row(this->png, r < skip_y ? row.data() : dst.row(r - skip_y), nullptr);
+					return;
+				}
+				// Interlaced images have to be read completely
+				if(passes > 1){
+					image.resize(this->height * rowbytes);
+					image_rows.resize(this->height);
+					for(unsigned r = 0; r < this->height; ++r)
+						image_rows[r] = image.data() + r * rowbytes;
+					png_read_image(this->png, image_rows.data());
+				}
+				// Rows conversion (with downscale)
+				const auto read_row = [&](const unsigned r) -> const unsigned char*{
+					if(passes > 1)
+						return image_rows[r];
+					png_read_row(this->png, row.data(), nullptr);
+					return row.data();
+				};
+				if(scale > 1){
+					scaled_row.resize(out_width * channels);
+					sums.resize(out_width * channels);
+				}
+				for(unsigned out_y = 0; out_y < skip_y + dst.height; ++out_y){
+					const unsigned char* src;
+					if(scale > 1){
+						std::fill(sums.begin(), sums.end(), 0);
+						const unsigned r_end = std::min(this->height, (out_y + 1) * scale);
+						for(unsigned r = out_y * scale; r < r_end; ++r)
+							accumulate_row(read_row(r), channels, this->width, scale, sums.data());
+						if(out_y < skip_y)
+							continue;
+						average_row(sums.data(), channels, this->width, scale, r_end - out_y * scale, scaled_row.data(), out_width);
+						src = scaled_row.data();
+					}else{
+						src = read_row(out_y);
+						if(out_y < skip_y)
+							continue;
+					}
+					convert_row(src + skip_x * channels, channels, dst.row(out_y - skip_y), dst.channels(), dst.width, premultiply);
+				}
+			}
+	};
+
+	// Numbered filenames by printf-like pattern with one integer conversion
+	inline bool valid_pattern(const std::string& pattern) noexcept{
+		unsigned conversions = 0;
+		for(size_t i = 0; i < pattern.length(); ++i)
+			if(pattern[i] == '%'){
+				if(++i < pattern.length() && pattern[i] == '%')
+					continue;
+				while(i < pattern.length() && (std::isdigit(static_cast<unsigned char>(pattern[i])) || pattern[i] == '-' || pattern[i] == '+' || pattern[i] == ' '))
+					++i;
+				if(i == pattern.length() || pattern[i] != 'd')
+					return false;
+				++conversions;
+			}
+		return conversions == 1;
+	}
+	inline std::string format_pattern(const std::string& pattern, const int i){
+		std::string result(std::snprintf(nullptr, 0, pattern.c_str(), i), '\0');
+		std::snprintf(&result[0], result.length() + 1, pattern.c_str(), i);
+		return result;
+	}
+
+	// Maps file into memory for decoding
+	inline std::unique_ptr<boost::interprocess::mapped_region> map_file(const std::string& filename){
+		try{
+			const boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+			return std::unique_ptr<boost::interprocess::mapped_region>(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+		}catch(const std::exception&){
+			throw std::runtime_error("Couldn't open input file '" + filename + "'!");
+		}
+	}
+
+	// Decodes PNG file into new canvas (premultiplied)
+	inline std::shared_ptr<Image::Canvas> load(const std::string& filename, const unsigned scale = 1){
+		const std::unique_ptr<boost::interprocess::mapped_region> region = map_file(filename);
+		Decoder decoder(static_cast<const unsigned char*>(region->get_address()), region->get_size());
+		const std::shared_ptr<Image::Canvas> canvas = std::make_shared<Image::Canvas>(Decoder::scaled(decoder.get_width(), scale), Decoder::scaled(decoder.get_height(), scale));
+		decoder.decode(canvas->view(), 0, 0, scale, true);
+		return canvas;
+	}
+
+	// Process-wide decoded files (BGR(A), straight alpha) by path, modification time, size & scale with memory budget and LRU eviction
+	class Cache{
+		public:
+			struct Stats{
+				uint64_t hits, misses, evictions;
+				size_t entries, bytes, budget;
+			};
+		private:
+			struct Key{
+				std::string path;
+				std::time_t mtime;
+				uintmax_t size;
+				unsigned scale;
+				bool operator<(const Key& other) const noexcept{
+					return std::tie(this->path, this->mtime, this->size, this->scale) < std::tie(other.path, other.mtime, other.size, other.scale);
+				}
+			};
+			typedef std::list<std::pair<Key, std::shared_ptr<const Image::Buffer>>> Entries;
+			// Most recently used first
+			Entries entries;
+			std::map<Key, Entries::iterator> index;
+			std::mutex mutex;
+			Stats stats = {0, 0, 0, 0, 0, 0};
+			void trim(){
+				while(this->stats.bytes > this->stats.budget && !this->entries.empty()){
+					this->stats.bytes -= this->entries.back().second->size();
+					this->index.erase(this->entries.back().first);
+					this->entries.pop_back();
+					++this->stats.evictions;
+				}
+				this->stats.entries = this->entries.size();
+			}
+		public:
+			// Ctor
+			Cache(const size_t budget = 256 << 20){this->stats.budget = budget;}
+			// No copy
+			Cache(const Cache&) = delete;
+			Cache& operator=(const Cache&) = delete;
+			// Get decoded file (images stay valid for holders after eviction)
+			std::shared_ptr<const Image::Buffer> get(const std::string& filename, const unsigned scale = 1){
+				boost::system::error_code ec;
+				const boost::filesystem::path path = boost::filesystem::canonical(filename, ec);
+				const std::time_t mtime = ec ? 0 : boost::filesystem::last_write_time(path, ec);
+				const uintmax_t size = ec ? 0 : boost::filesystem::file_size(path, ec);
+				if(ec)
+					throw std::runtime_error("Couldn't open input file '" + filename + "'!");
+				const Key key = {path.string(), mtime, size, scale};
+				// Cached?
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					const auto it = this->index.find(key);
+					if(it != this->index.end()){
+						this->entries.splice(this->entries.begin(), this->entries, it->second);
+						++this->stats.hits;
+						return it->second->second;
+					}
+					++this->stats.misses;
+				}
+				// Decode without lock
+				const std::unique_ptr<boost::interprocess::mapped_region> region = map_file(key.path);
+				Decoder decoder(static_cast<const unsigned char*>(region->get_address()), region->get_size());
+				const std::shared_ptr<Image::Buffer> image = std::make_shared<Image::Buffer>(Decoder::scaled(decoder.get_width(), scale), Decoder::scaled(decoder.get_height(), scale), decoder.get_has_alpha());
+				decoder.decode(image->view(), 0, 0, scale);
+				// Insert (unless another thread was faster)
+				std::lock_guard<std::mutex> lock(this->mutex);
+				const auto it = this->index.find(key);
+				if(it != this->index.end())
+					return it->second->second;
+				this->entries.emplace_front(key, image);
+				this->index[key] = this->entries.begin();
+				this->stats.bytes += image->size();
+				this->trim();
+				return image;
+			}
+			// Statistics
+			Stats get_stats(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				return this->stats;
+			}
+			// Memory limit (evicts immediately)
+			void set_budget(const size_t budget){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stats.budget = budget;
+				this->trim();
+			}
+			void clear(){
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->entries.clear();
+				this->index.clear();
+				this->stats.entries = this->stats.bytes = 0;
+			}
+	};
+	inline Cache& cache(){
+		static Cache instance;
+		return instance;
+	}
+
+	// Numbered PNG files with background decoding of frames around the last requested one
+	class Sequence{
+		private:
+			// Filenames by pattern
+			const std::string pattern;
+			// Range & prefetch window
+			int first, last;
+			const unsigned ahead, behind, cache_size, scale;
+			// Decoded or pending frames (cancel flag stops queued decoding of dropped frames)
+			struct Entry{
+				std::shared_future<std::shared_ptr<Image::Canvas>> result;
+				std::shared_ptr<std::atomic<bool>> cancel;
+			};
+			std::map<int, Entry> frames;
+			void request(const int i){
+				if(i < this->first || i > this->last || this->frames.count(i))
+					return;
+				const std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>(false);
+				const std::string filename = this->filename(i);
+				const unsigned scale = this->scale;
+				this->frames[i] = {Threading::pool().enqueue([cancel,filename,scale](){
+					return cancel->load() ? std::shared_ptr<Image::Canvas>() : load(filename, scale);
+				}).share(), cancel};
+			}
+		public:
+			// Ctor (last frame by files existence if not given)
+			Sequence(const std::string& pattern, const int first = 0, const int last = -1, const unsigned ahead = 4, const unsigned behind = 1, const unsigned cache_size = 8, const unsigned scale = 1)
+			: pattern(valid_pattern(pattern) ? pattern : throw std::invalid_argument("Pattern needs exactly one integer conversion!")),
+			first(first), last(last), ahead(ahead), behind(behind), cache_size(std::max(cache_size, ahead + behind + 1)), scale(scale){
+				if(this->last < this->first)
+					for(this->last = this->first - 1; boost::filesystem::exists(this->filename(this->last + 1)); ++this->last);
+			}
+			// No copy
+			Sequence(const Sequence&) = delete;
+			Sequence& operator=(const Sequence&) = delete;
+			// Dtor (drops queued decoding)
+			~Sequence(){
+				for(auto& frame : this->frames)
+					frame.second.cancel->store(true);
+			}
+			// Getters
+			int get_first() const noexcept{return this->first;}
+			int get_last() const noexcept{return this->last;}
+			std::string filename(const int i) const{return format_pattern(this->pattern, i);}
+			// Frame decoded already? (no waiting)
+			bool ready(const int i) const{
+				const auto it = this->frames.find(i);
+				return it != this->frames.end() && it->second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}
+			// Get frame (waits for decoding if not prefetched) & prefetch neighbours
+			std::shared_ptr<Image::Canvas> get(const int i){
+				if(i < this->first || i > this->last)
+					throw std::out_of_range("Frame index out of range!");
+				this->request(i);
+				for(unsigned d = 1; d <= std::max(this->ahead, this->behind); ++d){
+					if(d <= this->ahead) this->request(i + static_cast<int>(d));
+					if(d <= this->behind) this->request(i - static_cast<int>(d));
+				}
+				// Drop frames farthest away over cache size
+				while(this->frames.size() > this->cache_size){
+					const auto front = this->frames.begin(), back = std::prev(this->frames.end());
+					const auto drop = i - front->first > back->first - i ? front : back;
+					drop->second.cancel->store(true);
+					this->frames.erase(drop);
+				}
+				const std::shared_future<std::shared_ptr<Image::Canvas>> result = this->frames[i].result;
+				try{
+					return result.get();
+				}catch(...){
+					this->frames.erase(i);	// Retry next time
+					throw;
+				}
+			}
+	};
+
+	// Encodes image view as PNG (straight alpha output, premultiplied views get converted)
+	inline void encode(const Image::View& image, std::ostream& out, const int level = -1 /* zlib default */, const int filters = PNG_ALL_FILTERS, const bool bgr = true){
+		// Buffers before jump point (no leaks on errors)
+		std::vector<unsigned char> row;
+		png_infop info = nullptr;
+		const std::unique_ptr<png_struct,std::function<void(png_structp)>> png(png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, [](png_structp png, png_const_charp){png_longjmp(png, 1);}, [](png_structp, png_const_charp){}), [&info](png_structp png){png_destroy_write_struct(&png, &info);});
+		if(!png || !(info = png_create_info_struct(png.get())))
+			throw std::runtime_error("Couldn't create PNG structures!");
+		if(setjmp(png_jmpbuf(png.get())))
+			throw std::runtime_error("PNG write error occured!");
+		// Set PNG target writer
+		png_set_write_fn(png.get(), &out, [](png_structp png, png_bytep in, png_size_t in_size){
+			if(!static_cast<std::ostream*>(png_get_io_ptr(png))->write(reinterpret_cast<char*>(in), in_size))
+				png_error(png, "Couldn't write output!");
+		}, nullptr);
+		// Compression & header
+		if(level >= 0)
+			png_set_compression_level(png.get(), level);
+		png_set_filter(png.get(), PNG_FILTER_TYPE_BASE, filters);
+		png_set_IHDR(png.get(), info, image.width, image.height, 8, image.has_alpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_write_info(png.get(), info);
+		if(bgr)
+			png_set_bgr(png.get());
+		// Write rows
+		const bool unpremultiply = image.has_alpha && image.premultiplied;
+		if(unpremultiply)
+			row.resize(image.width << 2);
+		for(unsigned y = 0; y < image.height; ++y)
+			if(unpremultiply){
+				std::copy(image.row(y), image.row(y) + row.size(), row.begin());
+				Image::unpremultiply(row.data(), image.width);
+				png_write_row(png.get(), row.data());
+			}else
+				png_write_row(png.get(), image.row(y));
+		png_write_end(png.get(), info);
+	}
+
+	// Writes PNG files into a directory by encoding on worker threads
+	class Writer{
+		private:
+			// Output
+			const boost::filesystem::path dir;
+			const std::string pattern;
+			int next;
+			// Encoding
+			const int level, filters;
+			// Pending files (oldest first)
+			const unsigned queue_size;
+			std::deque<std::future<void>> pending;
+			void pop(){
+				std::future<void> oldest = std::move(this->pending.front());
+				this->pending.pop_front();
+				oldest.get();	// Rethrows encoding errors
+			}
+		public:
+			// Ctor (creates directory)
+			Writer(const std::string& dir, const std::string& pattern = "%06d.png", const int first = 0, const int level = -1, const int filters = PNG_ALL_FILTERS, const unsigned queue_size = 8)
+			: dir(dir), pattern(valid_pattern(pattern) ? pattern : throw std::invalid_argument("Pattern needs exactly one integer conversion!")),
+			next(first), level(level), filters(filters), queue_size(std::max(queue_size, 1u)){
+				boost::filesystem::create_directories(this->dir);
+			}
+			// No copy
+			Writer(const Writer&) = delete;
+			Writer& operator=(const Writer&) = delete;
+			// Dtor (finishes pending files, errors get lost)
+			~Writer(){
+				for(std::future<void>& file : this->pending)
+					if(file.valid())
+						file.wait();
+			}
+			// Number of files in work
+			size_t get_pending() const noexcept{return this->pending.size();}
+			// Queue image copy for writing (waits for oldest file if queue is full), returns file path
+			std::string write(const Image::View& image, const std::string& name = "", const bool bgr = true){
+				while(this->pending.size() >= this->queue_size)
+					this->pop();
+				// Pack image rows
+				const unsigned rowsize = image.width * image.channels();
+				const std::shared_ptr<std::vector<unsigned char>> data = std::make_shared<std::vector<unsigned char>>(rowsize * image.height);
+				for(unsigned y = 0; y < image.height; ++y)
+					std::copy(image.row(y), image.row(y) + rowsize, data->begin() + y * rowsize);
+				const Image::View packed = {data->data(), image.width, image.height, static_cast<ptrdiff_t>(rowsize), image.has_alpha, image.premultiplied};
+				// Encode into file by worker
+				const std::string path = (this->dir / (name.empty() ? format_pattern(this->pattern, this->next++) : name)).string();
+				const int level = this->level, filters = this->filters;
+				this->pending.push_back(Threading::pool().enqueue([data,packed,path,level,filters,bgr](){
+					std::ofstream file(path, std::ios_base::binary);
+					if(!file)
+						throw std::runtime_error("Couldn't open output file '" + path + "'!");
+					encode(packed, file, level, filters, bgr);
+					if(!file.flush())
+						throw std::runtime_error("Couldn't write output file '" + path + "'!");
+				}));
+				return path;
+			}
+			// Wait for all pending files
+			void flush(){
+				while(!this->pending.empty())
+					this->pop();
+			}
+	};
+}
@@ -0,0 +1,232 @@
+/*
+Project: FLuaG
+File: raster.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "math.hpp"
+#include "image.hpp"
+#include "threading.hpp"
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+#include <locale>
+
+namespace Raster{
+	// Closed polygon (last point connects to first)
+	typedef std::vector<Geometry::Point2d> Contour;
+
+	enum class FillRule{NON_ZERO, EVEN_ODD};
+
+	// Contours of ASS drawing commands (m, n, l, b, c)
+	inline std::vector<Contour> parse_ass(const std::string& drawing, const double tolerance = 0.1, const double dx = 0, const double dy = 0){
+		Geometry::PathBuilder path(tolerance);
+		std::istringstream stream(drawing);
+		stream.imbue(std::locale::classic());
+		char cmd = '\0';
+		double p[6];
+		const auto numbers = [&stream,&p](const int n){
+			for(int i = 0; i < n; ++i)
+				if(!(stream >> p[i]))
+					throw std::invalid_argument("Invalid drawing coordinates!");
+		};
+		while(stream >> std::ws, !stream.eof()){
+			const int next = stream.peek();
+			if(std::isalpha(next))
+				cmd = stream.get();
+			switch(cmd){
+				case 'm': case 'n': numbers(2); path.move(p[0], p[1]); break;
+				case 'l': numbers(2); path.line(p[0], p[1]); break;
+				case 'b': numbers(6); path.curve(p[0], p[1], p[2], p[3], p[4], p[5]); break;
+				case 'c': path.close(); cmd = '\0'; break;
+				default: throw std::invalid_argument("Unsupported drawing command!");
+			}
+		}
+		return path.get(dx, dy);
+	}
+
+	// Source color by position: solid or gradient over color stops (straight BGRA, offsets in [0,1])
+	class Paint{
+		public:
+			enum class Type{SOLID, LINEAR, RADIAL};
+			struct Stop{
+				double offset;
+				std::array<unsigned char,4> color;
+			};
+		private:
+			Type type;
+			double x0, y0, dx, dy, scale;
+			std::array<std::array<float,4>,256> ramp;	// Premultiplied, [0,1]
+			void set_stops(std::vector<Stop> stops){
+				if(stops.empty())
+					throw std::invalid_argument("Color stops expected!");
+				std::stable_sort(stops.begin(), stops.end(), [](const Stop& a, const Stop& b){return a.offset < b.offset;});
+				for(size_t i = 0; i < this->ramp.size(); ++i){
+					const double t = static_cast<double>(i) / (this->ramp.size() - 1);
+					const auto next = std::find_if(stops.begin(), stops.end(), [t](const Stop& stop){return stop.offset > t;});
+					const Stop& a = next == stops.begin() ? *next : *(next-1), &b = next == stops.end() ? *(next-1) : *next;
+					const double f = b.offset > a.offset ? (t - a.offset) / (b.offset - a.offset) : 0,
+						alpha = (a.color[3] + (b.color[3] - a.color[3]) * f) / 255;
+					for(int c = 0; c < 3; ++c)
+						this->ramp[i][c] = (a.color[c] + (b.color[c] - a.color[c]) * f) / 255 * alpha;
+					this->ramp[i][3] = alpha;
+				}
+			}
+		public:
+			// Solid color
+			Paint(const std::array<unsigned char,4>& color) : type(Type::SOLID), x0(0), y0(0), dx(0), dy(0), scale(0){
+				this->set_stops({{0, color}});
+			}
+			// Linear gradient from (x0,y0) to (x1,y1) or radial gradient around (x0,y0) with radius as distance to (x1,y1)
+			Paint(const Type type, const double x0, const double y0, const double x1, const double y1, const std::vector<Stop>& stops)
+			: type(type), x0(x0), y0(y0), dx(x1 - x0), dy(y1 - y0){
+				const double length2 = this->dx * this->dx + this->dy * this->dy;
+				this->scale = length2 > 0 ? (type == Type::LINEAR ? 1 / length2 : 1 / std::sqrt(length2)) : 0;
+				this->set_stops(stops);
+			}
+			// Premultiplied color at pixel center
+			const std::array<float,4>& color(const double x, const double y) const noexcept{
+				double t;
+				switch(this->type){
+					case Type::LINEAR: t = ((x - this->x0) * this->dx + (y - this->y0) * this->dy) * this->scale; break;
+					case Type::RADIAL: t = std::hypot(x - this->x0, y - this->y0) * this->scale; break;
+					case Type::SOLID: default: return this->ramp.front();
+				}
+				return this->ramp[static_cast<size_t>(std::max(0.0, std::min(1.0, t)) * (this->ramp.size() - 1) + 0.5)];
+			}
+			bool is_solid() const noexcept{return this->type == Type::SOLID;}
+	};
+
+	// Signed area of line in row cells (accumulation buffer, coverage by prefix sum over row)
+	inline void accumulate_line(Geometry::Point2d p0, Geometry::Point2d p1, float* acc, const unsigned width, const size_t acc_stride, const int row_first, const int row_last) noexcept{
+		if(p0.y == p1.y)
+			return;
+		float dir = 1;
+		if(p0.y > p1.y){
+			std::swap(p0, p1);
+			dir = -1;
+		}
+		const int y_first = std::max(row_first, static_cast<int>(std::floor(p0.y))),
+			y_last = std::min(row_last, static_cast<int>(std::ceil(p1.y)));
+		if(y_first >= y_last)
+			return;
+		const double dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+		double x = p0.x + (std::max(p0.y, static_cast<double>(y_first)) - p0.y) * dxdy;
+		for(int y = y_first; y < y_last; ++y){
+			const double dy = std::min(y + 1.0, p1.y) - std::max(static_cast<double>(y), p0.y),
+				x_next = x + dxdy * dy;
+			const float d = dy * dir;
+			// Horizontal extent clamped to image (left winding remains, right is irrelevant)
+			const double x0 = std::max(0.0, std::min(static_cast<double>(width), std::min(x, x_next))),
+				x1 = std::max(0.0, std::min(static_cast<double>(width), std::max(x, x_next)));
+			float* row = acc + (y - row_first) * acc_stride;
+			const double x0_floor = std::floor(x0), x1_ceil = std::ceil(x1);
+			const int x0i = x0_floor, x1i = x1_ceil;
+			if(x1i <= x0i + 1){
+				// Within one cell
+				const float xm = 0.5 * (x0 + x1) - x0_floor;
+				row[x0i] += d - d * xm;
+				row[x0i+1] += d * xm;
+			}else{
+				// Over multiple cells: partial areas at ends, constant slope between
+				const float s = 1 / (x1 - x0),
+					x0f = x0 - x0_floor,
+					a0 = 0.5f * s * (1 - x0f) * (1 - x0f),
+					x1f = x1 - x1_ceil + 1,
+					am = 0.5f * s * x1f * x1f;
+				row[x0i] += d * a0;
+				if(x1i == x0i + 2)
+					row[x0i+1] += d * (1 - a0 - am);
+				else{
+					const float a1 = s * (1.5f - x0f);
+					row[x0i+1] += d * (a1 - a0);
+					for(int xi = x0i + 2; xi < x1i - 1; ++xi)
+						row[xi] += d * s;
+					const float a2 = a1 + (x1i - x0i - 3) * s;
+					row[x1i-1] += d * (1 - a2 - am);
+				}
+				row[x1i] += d * am;
+			}
+			x = x_next;
+		}
+	}
+
+	// Coverage of contours in rows, blended with paint into image (source over)
+	inline void fill_rows(const std::vector<Contour>& contours, const FillRule rule, const Paint& paint, const Image::View& image, const int row_first, const int row_last){
+		if(row_first >= row_last || !image.width)
+			return;
+		const size_t acc_stride = image.width + 2;
+		std::vector<float> acc(acc_stride * (row_last - row_first), 0);
+		for(const Contour& contour : contours)
+			for(size_t i = 0, n = contour.size(); i < n; ++i)
+				accumulate_line(contour[i], contour[i+1 == n ? 0 : i+1], acc.data(), image.width, acc_stride, row_first, row_last);
+		const unsigned channels = image.channels();
+		for(int y = row_first; y < row_last; ++y){
+			const float* row = acc.data() + (y - row_first) * acc_stride;
+			unsigned char* dst = image.row(y);
+			float winding = 0;
+			for(unsigned x = 0; x < image.width; ++x, dst += channels){
+				winding += row[x];
+				const float coverage = rule == FillRule::NON_ZERO ? std::min(1.0f, std::abs(winding)) : std::abs(winding - 2 * std::round(winding * 0.5f));
+				if(coverage < 1.0f / 512)
+					continue;
+				const std::array<float,4>& color = paint.color(x + 0.5, y + 0.5);
+				const float sa = color[3] * coverage, inv_sa = 1 - sa;
+				if(!image.has_alpha || image.premultiplied){
+					for(int c = 0; c < 3; ++c)
+						dst[c] = static_cast<unsigned char>(color[c] * coverage * 255 + dst[c] * inv_sa + 0.5f);
+					if(image.has_alpha)
+						dst[3] = static_cast<unsigned char>(sa * 255 + dst[3] * inv_sa + 0.5f);
+				}else{
+					const float da = dst[3] / 255.0f, out_a = sa + da * inv_sa;
+					if(out_a > 0)
+						for(int c = 0; c < 3; ++c)
+							dst[c] = static_cast<unsigned char>(std::min(255.0f, (color[c] * coverage * 255 + dst[c] * da * inv_sa) / out_a + 0.5f));
+					dst[3] = static_cast<unsigned char>(out_a * 255 + 0.5f);
+				}
+			}
+		}
+	}
+
+	// Fills contours into image, rows split into bands over process-wide thread pool (threads <= 1 renders in caller)
+	inline void fill(const std::vector<Contour>& contours, const FillRule rule, const Paint& paint, const Image::View& image, unsigned threads = 1){
+		// Rows touched by contours
+		double min_y = image.height, max_y = 0;
+		for(const Contour& contour : contours)
+			for(const Geometry::Point2d& p : contour)
+				min_y = std::min(min_y, p.y), max_y = std::max(max_y, p.y);
+		const int row_first = std::max(0, static_cast<int>(std::floor(min_y))),
+			row_last = std::min(static_cast<int>(image.height), static_cast<int>(std::ceil(max_y)));
+		if(row_first >= row_last)
+			return;
+		// Bands of at least 16 rows
+		threads = std::max(1u, std::min({threads, static_cast<unsigned>(Threading::pool().size()), static_cast<unsigned>((row_last - row_first + 15) / 16)}));
+		if(threads == 1)
+			return fill_rows(contours, rule, paint, image, row_first, row_last);
+		const int band = (row_last - row_first + threads - 1) / threads;
+		std::vector<std::future<void>> bands;
+		for(int y = row_first; y < row_last; y += band)
+			bands.push_back(Threading::pool().enqueue([&contours,rule,&paint,&image,y,band,row_last](){
+				fill_rows(contours, rule, paint, image, y, std::min(y + band, row_last));
+			}));
+		for(auto& result : bands)	// All bands done before any error leaves (tasks reference arguments)
+			result.wait();
+		for(auto& result : bands)
+			result.get();
+	}
+}
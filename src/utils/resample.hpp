@@ -0,0 +1,248 @@
+/*
+Project: FLuaG
+File: resample.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "image.hpp"
+#include "filter.hpp"
+#include "math.hpp"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#ifndef RESAMPLE_PRECISION
+	#define RESAMPLE_PRECISION 14	// Fraction bits of fixed-point weights (16-bit weights, 32-bit sums)
+#endif
+
+namespace Resample{
+	enum class Kernel{BILINEAR, BICUBIC, LANCZOS};
+
+	// Kernel radius & value at source sample distance
+	inline double support(const Kernel kernel) noexcept{
+		return kernel == Kernel::BILINEAR ? 1 : kernel == Kernel::BICUBIC ? 2 : 3;
+	}
+	inline double value(const Kernel kernel, double x) noexcept{
+		x = std::abs(x);
+		switch(kernel){
+			case Kernel::BILINEAR: return x < 1 ? 1 - x : 0;
+			case Kernel::BICUBIC: return x < 1 ? (1.5 * x - 2.5) * x * x + 1 : x < 2 ? ((-0.5 * x + 2.5) * x - 4) * x + 2 : 0;	// Catmull-Rom
+			case Kernel::LANCZOS:{
+				if(x < 1e-8) return 1;
+				if(x >= 3) return 0;
+				const double px = M_PI * x;
+				return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+			}
+		}
+		return 0;
+	}
+
+	// Precomputed weights of one direction: destination sample i = sum of taps source samples from first[i]
+	class Weights{
+		private:
+			unsigned taps;
+			std::vector<unsigned> first;
+			std::vector<int16_t> coeffs;
+		public:
+			// Source range [offset, offset+length) scaled to destination size (kernel widens on downscale)
+			Weights(const unsigned src_size, const double offset, const double length, const unsigned dst_size, const Kernel kernel)
+			: first(dst_size){
+				const double scale = length / dst_size, filter_scale = std::max(1.0, scale), radius = support(kernel) * filter_scale;
+				this->taps = std::min(src_size, static_cast<unsigned>(std::ceil(radius)) * 2 + 1);
+				this->coeffs.assign(static_cast<size_t>(dst_size) * this->taps, 0);
+				std::vector<double> weights;
+				for(unsigned i = 0; i < dst_size; ++i){
+					// Window around source position of destination sample center, clamped to hold at least one source sample
+					const double center = offset + (i + 0.5) * scale;
+					const int last = static_cast<int>(src_size) - 1,
+						lo = static_cast<int>(std::max(0.0, std::min<double>(last, std::floor(center - radius + 0.5)))),
+						hi = static_cast<int>(std::max<double>(lo + 1, std::min<double>(src_size, std::floor(center + radius + 0.5))));
+					weights.assign(hi - lo, 0);
+					double sum = 0;
+					for(int j = lo; j < hi; ++j)
+						sum += weights[j - lo] = value(kernel, (j + 0.5 - center) / filter_scale);
+					if(sum == 0)
+						weights[center < lo ? 0 : hi - lo - 1] = sum = 1;	// Nearest edge sample outside kernel support
+					// Fixed taps window inside source, normalized fixed-point weights with exact unit sum
+					const unsigned window_first = std::min(static_cast<unsigned>(lo), src_size - this->taps);
+					int16_t* coeffs = this->coeffs.data() + static_cast<size_t>(i) * this->taps;
+					int total = 0;
+					size_t max_j = 0;
+					for(size_t j = 0; j < weights.size() && lo - window_first + j < this->taps; ++j){
+						total += coeffs[lo - window_first + j] = static_cast<int16_t>(std::lround(weights[j] / sum * (1 << RESAMPLE_PRECISION)));
+						if(std::abs(weights[j]) > std::abs(weights[max_j]))
+							max_j = j;
+					}
+					coeffs[lo - window_first + max_j] += (1 << RESAMPLE_PRECISION) - total;
+					this->first[i] = window_first;
+				}
+			}
+			// Getters
+			unsigned get_taps() const noexcept{return this->taps;}
+			unsigned get_first(const unsigned i) const noexcept{return this->first[i];}
+			const int16_t* get_coeffs(const unsigned i) const noexcept{return this->coeffs.data() + static_cast<size_t>(i) * this->taps;}
+	};
+
+	// Fixed-point sum to byte
+	inline unsigned char clamp(const int32_t sum) noexcept{
+		return static_cast<unsigned char>(std::max(0, std::min(255, (sum + (1 << (RESAMPLE_PRECISION - 1))) >> RESAMPLE_PRECISION)));
+	}
+	// Overshoot of negative lobes mustn't let premultiplied colors exceed alpha
+	inline void clamp_premultiplied(unsigned char* row, const unsigned width) noexcept{
+		for(unsigned char* const row_end = row + (width << 2); row != row_end; row += 4)
+			row[0] = std::min(row[0], row[3]), row[1] = std::min(row[1], row[3]), row[2] = std::min(row[2], row[3]);
+	}
+
+	// Horizontal pass of one row (channels unrolled)
+	template<unsigned Channels>
+	inline void resample_row(const unsigned char* src, unsigned char* dst, const unsigned width, const Weights& weights) noexcept{
+		const unsigned taps = weights.get_taps();
+		for(unsigned x = 0; x < width; ++x, dst += Channels){
+			const unsigned char* s = src + weights.get_first(x) * Channels;
+			const int16_t* coeffs = weights.get_coeffs(x);
+			int32_t sums[Channels] = {};
+			for(unsigned t = 0; t < taps; ++t, s += Channels)
+				for(unsigned c = 0; c < Channels; ++c)
+					sums[c] += s[c] * coeffs[t];
+			for(unsigned c = 0; c < Channels; ++c)
+				dst[c] = clamp(sums[c]);
+		}
+	}
+
+	// Scales source to destination view of same format (no overlap), separable passes split into bands on thread pool
+	inline void resize_direct(const Image::View& src, const Image::View& dst, const double x, const double y, const double width, const double height, const Kernel kernel, const unsigned threads){
+		const unsigned channels = src.channels();
+		const Weights weights_x(src.width, x, width, dst.width, kernel),
+			weights_y(src.height, y, height, dst.height, kernel);
+		// Horizontal pass over used source rows
+		const unsigned row_first = weights_y.get_first(0),
+			row_last = weights_y.get_first(dst.height - 1) + weights_y.get_taps();
+		const size_t tmp_stride = static_cast<size_t>(dst.width) * channels;
+		std::vector<unsigned char> tmp(tmp_stride * (row_last - row_first));
+		Filter::parallel(row_last - row_first, threads, [&](const unsigned first, const unsigned last){
+			for(unsigned y = first; y < last; ++y){
+				unsigned char* row = tmp.data() + y * tmp_stride;
+				if(channels == 4){
+					resample_row<4>(src.row(row_first + y), row, dst.width, weights_x);
+					if(src.premultiplied)
+						clamp_premultiplied(row, dst.width);
+				}else
+					resample_row<3>(src.row(row_first + y), row, dst.width, weights_x);
+			}
+		});
+		// Vertical pass as weighted row sums
+		Filter::parallel(dst.height, threads, [&](const unsigned first, const unsigned last){
+			std::vector<int32_t> sums(tmp_stride);
+			for(unsigned y = first; y < last; ++y){
+				std::fill(sums.begin(), sums.end(), 0);
+				const int16_t* coeffs = weights_y.get_coeffs(y);
+				for(unsigned t = 0, taps = weights_y.get_taps(); t < taps; ++t){
+					const unsigned char* row = tmp.data() + (weights_y.get_first(y) - row_first + t) * tmp_stride;
+					const int32_t coeff = coeffs[t];
+					for(size_t i = 0; i < tmp_stride; ++i)
+						sums[i] += row[i] * coeff;
+				}
+				// Locals for stores of bytes, which may alias any captured state
+				unsigned char* const row = dst.row(y);
+				const int32_t* const sum = sums.data();
+				for(size_t i = 0, n = sums.size(); i < n; ++i)
+					row[i] = clamp(sum[i]);
+				if(channels == 4 && dst.premultiplied)
+					clamp_premultiplied(row, dst.width);
+			}
+		});
+	}
+
+	// Scales source rectangle (sub-pixel) into destination, converting formats via premultiplied buffers
+	inline void resize(const Image::View& src, const Image::View& dst, const double x, const double y, const double width, const double height,
+			const Kernel kernel = Kernel::BICUBIC, const unsigned threads = 1){
+		if(!src.width || !src.height || !dst.width || !dst.height || width <= 0 || height <= 0)
+			return;
+		const auto bounds = [](const Image::View& view){
+			const unsigned char* a = view.row(0), *b = view.row(view.height - 1);
+			return std::make_pair(std::min(a, b), std::max(a, b) + view.width * view.channels());
+		};
+		const auto src_bounds = bounds(src), dst_bounds = bounds(dst);
+		const bool overlap = src_bounds.first < dst_bounds.second && dst_bounds.first < src_bounds.second,
+			src_work = !src.has_alpha || src.premultiplied;	// Straight alpha would bleed hidden colors
+		if(!overlap && src_work && src.has_alpha == dst.has_alpha && src.premultiplied == dst.premultiplied)
+			return resize_direct(src, dst, x, y, width, height, kernel, threads);
+		// Intermediate copies in working format
+		std::unique_ptr<Image::Buffer> src_copy;
+		Image::View src_view = src;
+		if(overlap || !src_work){
+			src_copy.reset(new Image::Buffer(src.width, src.height, src.has_alpha, src.has_alpha));
+			src_view = src_copy->view();
+			Image::copy(src, src_view);
+		}
+		Image::Buffer dst_buffer(dst.width, dst.height, src.has_alpha, src.has_alpha);
+		resize_direct(src_view, dst_buffer.view(), x, y, width, height, kernel, threads);
+		Image::copy(dst_buffer.view(), dst);
+	}
+	inline void resize(const Image::View& src, const Image::View& dst, const Kernel kernel = Kernel::BICUBIC, const unsigned threads = 1){
+		resize(src, dst, 0, 0, src.width, src.height, kernel, threads);
+	}
+
+	// Half-sized level by 2x2 averages (odd sizes repeat last row/column)
+	inline void downsample(const Image::View& src, const Image::View& dst, const unsigned threads = 1){
+		const unsigned channels = src.channels();
+		Filter::parallel(dst.height, threads, [&src,&dst,channels](const unsigned first, const unsigned last){
+			for(unsigned y = first; y < last; ++y){
+				const unsigned char* row1 = src.row(std::min(y << 1, src.height - 1)), *row2 = src.row(std::min((y << 1) + 1, src.height - 1));
+				unsigned char* out = dst.row(y);
+				for(unsigned x = 0; x < dst.width; ++x){
+					const unsigned x1 = std::min(x << 1, src.width - 1) * channels, x2 = std::min((x << 1) + 1, src.width - 1) * channels;
+					for(unsigned c = 0; c < channels; ++c)
+						*out++ = (row1[x1 + c] + row1[x2 + c] + row2[x1 + c] + row2[x2 + c] + 2) >> 2;
+				}
+			}
+		});
+	}
+	// Mipmap pyramid: levels halving down to 1x1 (first level is half of source)
+	inline std::vector<std::unique_ptr<Image::Canvas>> mipmaps(const Image::View& src, unsigned levels = ~0u, const unsigned threads = 1){
+		std::vector<std::unique_ptr<Image::Canvas>> result;
+		Image::View level = src;
+		std::unique_ptr<Image::Buffer> converted;
+		if(src.has_alpha && !src.premultiplied){
+			converted.reset(new Image::Buffer(src.width, src.height, true, true));
+			Image::copy(src, converted->view());
+			level = converted->view();
+		}
+		while(levels-- && (level.width > 1 || level.height > 1)){
+			result.emplace_back(new Image::Canvas((level.width + 1) >> 1, (level.height + 1) >> 1));
+			const Image::View next = result.back()->view();
+			if(level.has_alpha)
+				downsample(level, next, threads);
+			else{
+				Image::Buffer half(next.width, next.height, false);
+				downsample(level, half.view(), threads);
+				Image::copy(half.view(), next);
+			}
+			level = next;
+		}
+		return result;
+	}
+	// Pyramid level to resample from: smallest still at least destination size (0 = source)
+	inline size_t select_level(const std::vector<Image::View>& levels, const double width, const double height, const unsigned dst_width, const unsigned dst_height) noexcept{
+		size_t level = 0;
+		for(size_t i = 1; i < levels.size(); ++i){
+			const double scale_x = static_cast<double>(levels[i].width) / levels[0].width, scale_y = static_cast<double>(levels[i].height) / levels[0].height;
+			if(width * scale_x < dst_width || height * scale_y < dst_height)
+				break;
+			level = i;
+		}
+		return level;
+	}
+}
@@ -0,0 +1,64 @@
+/*
+Project: FLuaG
+File: sdf.hpp
+
+Copyright (c) 2015-2016, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "math.hpp"
+#include <vector>
+#include <limits>
+#include <cstddef>
+
+namespace SDF{
+	// Closed polygon (last point connects to first)
+	typedef std::vector<Geometry::Point2d> Contour;
+
+	// Squared distance of point to line segment
+	inline double segment_distance2(const Geometry::Point2d& p, const Geometry::Point2d& a, const Geometry::Point2d& b) noexcept{
+		const double abx = b.x - a.x, aby = b.y - a.y,
+			len2 = abx * abx + aby * aby,
+			t = len2 > 0 ? std::max(0.0, std::min(1.0, ((p.x - a.x) * abx + (p.y - a.y) * aby) / len2)) : 0,
+			dx = a.x + t * abx - p.x, dy = a.y + t * aby - p.y;
+		return dx * dx + dy * dy;
+	}
+
+	// Renders signed distances to contours (non-zero winding) into 8-bit samples: edge at 128, inside higher, +-spread units saturate.
+	// Sample (x,y) measures at contour position (origin_x + x + 0.5, origin_y + y + 0.5).
+	inline void render(const std::vector<Contour>& contours, const double origin_x, const double origin_y, const double spread,
+			unsigned char* data, const unsigned width, const unsigned height, const ptrdiff_t stride, const unsigned channels = 1) noexcept{
+		const double value_scale = 127.5 / spread;
+		for(unsigned y = 0; y < height; ++y){
+			unsigned char* row = data + static_cast<ptrdiff_t>(y) * stride;
+			for(unsigned x = 0; x < width; ++x, row += channels){
+				const Geometry::Point2d p{origin_x + x + 0.5, origin_y + y + 0.5};
+				double min_distance2 = std::numeric_limits<double>::max();
+				int winding = 0;
+				for(const Contour& contour : contours)
+					for(size_t i = 0, n = contour.size(); i < n; ++i){
+						const Geometry::Point2d& a = contour[i], &b = contour[i+1 == n ? 0 : i+1];
+						min_distance2 = std::min(min_distance2, segment_distance2(p, a, b));
+						// Crossings of horizontal ray to the right
+						if(a.y <= p.y){
+							if(b.y > p.y && Geometry::normal_z(a, b, p) > 0)
+								++winding;
+						}else if(b.y <= p.y && Geometry::normal_z(a, b, p) < 0)
+							--winding;
+					}
+				const double distance = std::sqrt(min_distance2) * (winding ? 1 : -1),
+					value = std::max(0.0, std::min(255.0, 127.5 + distance * value_scale));
+				for(unsigned c = 0; c < channels; ++c)
+					row[c] = static_cast<unsigned char>(value);
+			}
+		}
+	}
+}
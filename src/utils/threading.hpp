@@ -16,6 +16,12 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #include <thread>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <memory>
 
 namespace Threading{
 	// Allows function executions in same thread
@@ -92,5 +98,87 @@ namespace Threading{
 				this->client_future = this->client_promise.get_future();
 			}
 	};
-}
 
+	// Fixed number of worker threads processing queued tasks
+	class Pool{
+		private:
+			std::vector<std::thread> workers;
+			std::deque<std::function<void()>> tasks;
+			std::mutex mutex;
+			std::condition_variable cv;
+			bool stop = false;
+		public:
+			// Ctor
+			Pool(unsigned threads = std::thread::hardware_concurrency()){
+				for(threads = std::max(threads, 1u); threads; --threads)
+					this->workers.emplace_back([this](){
+						while(true){
+							std::function<void()> task;
+							{
+								std::unique_lock<std::mutex> lock(this->mutex);
+								this->cv.wait(lock, [this](){return this->stop || !this->tasks.empty();});
+								if(this->tasks.empty())
+									return;
+								task = std::move(this->tasks.front());
+								this->tasks.pop_front();
+							}
+							task();
+						}
+					});
+			}
+			// No copy
+			Pool(const Pool&) = delete;
+			Pool& operator=(const Pool&) = delete;
+			// Dtor (finishes queued tasks)
+			~Pool(){
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					this->stop = true;
+				}
+				this->cv.notify_all();
+				for(std::thread& worker : this->workers)
+					worker.join();
+			}
+			// Number of workers
+			size_t size() const noexcept{return this->workers.size();}
+			// Queue task, result by future
+			template<typename F>
+			std::future<typename std::result_of<F()>::type> enqueue(F func){
+				const auto task = std::make_shared<std::packaged_task<typename std::result_of<F()>::type()>>(std::move(func));
+				std::future<typename std::result_of<F()>::type> result = task->get_future();
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					this->tasks.emplace_back([task](){(*task)();});
+				}
+				this->cv.notify_one();
+				return result;
+			}
+	};
+
+	// Process-wide pool for background work of libraries (created on demand, joined only by shutdown: never
+	// by static destruction, which runs under the loader lock on library unload where joining threads deadlocks)
+	inline std::mutex& pool_mutex(){
+		static std::mutex instance;
+		return instance;
+	}
+	inline Pool*& pool_instance(){
+		static Pool* instance = nullptr;
+		return instance;
+	}
+	inline Pool& pool(){
+		std::lock_guard<std::mutex> lock(pool_mutex());
+		Pool*& instance = pool_instance();
+		if(!instance)
+			instance = new Pool;
+		return *instance;
+	}
+	// Finishes queued tasks and joins workers (no library work may run concurrently, next use creates a new pool)
+	inline void shutdown(){
+		std::unique_ptr<Pool> instance;
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex());
+			instance.reset(pool_instance());
+			pool_instance() = nullptr;
+		}
+	}
+}